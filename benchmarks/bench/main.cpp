@@ -0,0 +1,657 @@
+/*
+                        ste::timer benchmarks
+
+                 Measures fire-time jitter, sustained expirations
+                 per second, start() / stop() / set_interval() churn,
+                 memory and threads per armed timer, and the cost of
+                 set_function(). Prints CSV (default) or JSON.
+
+                 Usage: ste-timer-bench [--json] [--quick] [case...]
+                 Cases: jitter throughput churn footprint swap timeout scaling
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../include/fixed_timer.hpp"
+
+#include "../../include/inplace_function.hpp"
+
+#include "../../include/sharded_timer_service.hpp"
+
+#include "../../include/timer.hpp"
+
+#include <algorithm>
+
+#include <atomic>
+
+#include <chrono>
+
+#include <condition_variable>
+
+#include <cstdint>
+
+#include <cstdlib>
+
+#include <fstream>
+
+#include <iostream>
+
+#include <memory>
+
+#include <mutex>
+
+#include <random>
+
+#include <string>
+
+#include <thread>
+
+#include <type_traits>
+
+#include <utility>
+
+#include <vector>
+
+namespace
+{
+
+using function_t = ste::inplace_function<void(void)>;
+
+/// One measurement.
+struct result
+{
+    std::string bench;      ///< Case name.
+    std::string parameter;  ///< What was varied, e.g. "interval=1ms".
+    std::string metric;
+    double value;
+    std::string unit;
+};
+
+std::vector<result> results;
+
+bool quick = false;
+
+void report(std::string bench, std::string parameter, std::string metric, const double value, std::string unit)
+{
+    results.push_back({std::move(bench), std::move(parameter), std::move(metric), value, std::move(unit)});
+    std::cerr << results.back().bench << " " << results.back().parameter << " "
+              << results.back().metric << ": " << value << " " << results.back().unit << std::endl;
+}
+
+double ns_per(const std::chrono::steady_clock::duration elapsed, const std::uint64_t count)
+{
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(count);
+}
+
+/// Reads a field of /proc/self/status (in kB for memory fields). -1 if unavailable.
+double proc_status(const std::string& field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while(std::getline(status, line))
+    {
+        if(line.compare(0, field.size() + 1, field + ":") == 0)
+        {
+            return std::stod(line.substr(field.size() + 1));
+        }
+    }
+
+    return -1;
+}
+
+/*********************************************************************/
+/*                               Jitter                              */
+/*********************************************************************/
+
+/// 'true' for ste::timer, which measures its own lateness, 'false' for ste::fixed_timer.
+template<typename timer_t, typename = void>
+struct has_jitter : std::false_type {};
+
+template<typename timer_t>
+struct has_jitter<timer_t, std::void_t<decltype(std::declval<timer_t&>().jitter())>> : std::true_type {};
+
+/// Fires 'timer' 'ticks' times, and reports its lateness and the deviation of the periods.
+template<typename timer_t>
+void jitter_case(const std::string& parameter, timer_t& t, const std::chrono::nanoseconds period, const std::size_t ticks)
+{
+    std::vector<std::chrono::steady_clock::time_point> calls(ticks);
+    std::atomic<std::size_t> count = 0;
+    std::mutex mutex;
+    std::condition_variable done;
+
+    t.set_function([&]()
+    {
+        const auto i = count.load(std::memory_order_relaxed);
+
+        if(i < calls.size())
+        {
+            calls[i] = std::chrono::steady_clock::now();
+            count.store(i + 1, std::memory_order_release);
+        }
+
+        if(i + 1 == calls.size())
+        {
+            std::lock_guard lock(mutex);
+            done.notify_all();
+        }
+    });
+
+    if constexpr(has_jitter<timer_t>::value)
+    {
+        t.set_period_mode(ste::period_mode::skip);
+        t.reset_jitter();
+    }
+
+    t.start();
+
+    {
+        std::unique_lock lock(mutex);
+        done.wait(lock, [&]() { return count.load(std::memory_order_acquire) >= calls.size(); });
+    }
+
+    t.stop();
+
+    std::vector<double> deviations;
+    deviations.reserve(calls.size());
+
+    for(std::size_t i = 1; i < calls.size(); ++i)
+    {
+        const auto actual = std::chrono::duration<double, std::nano>(calls[i] - calls[i - 1]).count();
+        deviations.push_back(std::abs(actual - static_cast<double>(period.count())));
+    }
+
+    std::sort(deviations.begin(), deviations.end());
+
+    if constexpr(has_jitter<timer_t>::value)
+    {
+        const auto jitter = t.jitter();
+
+        report("jitter", parameter, "lateness_mean", static_cast<double>(jitter.mean.count()), "ns");
+        report("jitter", parameter, "lateness_max", static_cast<double>(jitter.max.count()), "ns");
+    }
+
+    report("jitter", parameter, "period_deviation_p50", deviations[deviations.size() / 2], "ns");
+    report("jitter", parameter, "period_deviation_p99", deviations[deviations.size() * 99 / 100], "ns");
+
+    if constexpr(has_jitter<timer_t>::value)
+    {
+        report("jitter", parameter, "missed_ticks", static_cast<double>(t.missed_ticks()), "ticks");
+    }
+}
+
+void jitter()
+{
+    const std::size_t ticks = quick ? 100 : 1000;
+
+    {
+        ste::ns_timer<function_t> t([]() {}, 100000, 0, false);
+        jitter_case("interval=100000ns", t, std::chrono::nanoseconds(100000), ticks);
+        t.set_spin_threshold(std::chrono::microseconds(50));
+        jitter_case("interval=100000ns,spin=50us", t, std::chrono::nanoseconds(100000), ticks);
+    }
+
+    {
+        ste::us_timer<function_t> t([]() {}, 500, 0, false);
+        jitter_case("interval=500us", t, std::chrono::microseconds(500), ticks);
+    }
+
+    {
+        ste::fixed_timer<function_t, std::chrono::microseconds, 500, ste::shot::periodic, ste::mutability::function> t([]() {});
+        jitter_case("fixed_timer,interval=500us", t, std::chrono::microseconds(500), ticks);
+    }
+
+    {
+        ste::ms_timer<function_t> t([]() {}, 2, 0, false);
+        jitter_case("interval=2ms", t, std::chrono::milliseconds(2), ticks / 2);
+    }
+}
+
+/*********************************************************************/
+/*                             Throughput                            */
+/*********************************************************************/
+
+/// Reports the number of expirations per second served when more are due than can be served.
+void throughput()
+{
+    const auto duration = quick ? std::chrono::milliseconds(200) : std::chrono::milliseconds(1000);
+
+    {
+        std::atomic<std::uint64_t> calls = 0;
+        ste::ns_timer<function_t> t([&]() { calls.fetch_add(1, std::memory_order_relaxed); }, 1, 0, false);
+        t.set_period_mode(ste::period_mode::catch_up);
+
+        t.start();
+        std::this_thread::sleep_for(duration);
+        t.stop();
+
+        report("throughput", "timer,interval=1ns", "expirations",
+               static_cast<double>(calls.load()) / std::chrono::duration<double>(duration).count(), "1/s");
+    }
+
+    for(const std::size_t timers : {std::size_t(1), std::size_t(1000)})
+    {
+        std::atomic<std::uint64_t> calls = 0;
+        ste::timer_service service;
+        service.reserve(timers);
+
+        for(std::size_t i = 0; i < timers; ++i)
+        {
+            service.schedule_every(std::chrono::nanoseconds(1), std::chrono::nanoseconds(1),
+                                   [&]() { calls.fetch_add(1, std::memory_order_relaxed); });
+        }
+
+        std::this_thread::sleep_for(duration);
+        const auto served = calls.load();
+
+        report("throughput", "service,timers=" + std::to_string(timers), "expirations",
+               static_cast<double>(served) / std::chrono::duration<double>(duration).count(), "1/s");
+    }
+}
+
+/*********************************************************************/
+/*                               Churn                               */
+/*********************************************************************/
+
+/// Reproduces the former behaviour of ste::timer: each start() creates a thread, stop() ends it.
+class thread_per_start
+{
+    std::atomic<bool> _stopped = true;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _thread;
+
+public:
+
+    ~thread_per_start()
+    {
+        stop();
+
+        if(_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    void start()
+    {
+        if(_thread.joinable())
+        {
+            _thread.join();
+        }
+
+        _stopped = false;
+
+        _thread = std::thread([this]()
+        {
+            std::unique_lock lock(_mutex);
+            _cv.wait_for(lock, std::chrono::hours(1), [this]() { return _stopped.load(); });
+        });
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stopped = true;
+        }
+
+        _cv.notify_all();
+    }
+};
+
+template<typename timer_t>
+double start_stop(timer_t& t, const std::uint64_t cycles)
+{
+    const auto begin = std::chrono::steady_clock::now();
+
+    for(std::uint64_t i = 0; i < cycles; ++i)
+    {
+        t.start();
+        t.stop();
+    }
+
+    return ns_per(std::chrono::steady_clock::now() - begin, cycles);
+}
+
+template<typename timer_t>
+double set_interval(timer_t& t, const std::uint64_t cycles)
+{
+    t.start();
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    for(std::uint64_t i = 0; i < cycles; ++i)
+    {
+        t.set_interval(1 + i % 2);
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    t.stop();
+
+    return ns_per(elapsed, cycles);
+}
+
+void churn()
+{
+    const std::uint64_t cycles = quick ? 10000 : 100000;
+
+    ste::hour_timer<function_t> t1([]() {}, 1, 0, false);
+    ste::timer_service service;
+    ste::hour_timer<function_t> t2(service, []() {}, 1, 0, false);
+    thread_per_start t3;
+
+    report("churn", "timer", "start_stop", start_stop(t1, cycles), "ns");
+    report("churn", "service", "start_stop", start_stop(t2, cycles), "ns");
+    report("churn", "thread_per_start", "start_stop", start_stop(t3, cycles / 100), "ns");
+    report("churn", "timer", "set_interval", set_interval(t1, cycles), "ns");
+    report("churn", "service", "set_interval", set_interval(t2, cycles), "ns");
+}
+
+/*********************************************************************/
+/*                             Footprint                             */
+/*********************************************************************/
+
+/// Reports the memory and threads used by 'count' armed timers, created by 'make'.
+template<typename make_f>
+void footprint_case(const std::string& parameter, const std::size_t count, make_f make)
+{
+    using timer_t = typename decltype(make())::element_type;
+
+    const auto rss     = proc_status("VmRSS");
+    const auto threads = proc_status("Threads");
+
+    std::vector<std::unique_ptr<timer_t>> timers;
+    timers.reserve(count);
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        timers.push_back(make());
+        timers.back()->start();
+    }
+
+    // Let the workers reach their wait.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    report("footprint", parameter, "rss_per_timer", (proc_status("VmRSS") - rss) * 1024 / static_cast<double>(count), "B");
+    report("footprint", parameter, "threads", proc_status("Threads") - threads, "threads");
+}
+
+void footprint()
+{
+    report("footprint", "timer", "sizeof", sizeof(ste::hour_timer<function_t>), "B");
+
+    for(const std::size_t count : {std::size_t(1000), std::size_t(10000), std::size_t(100000)})
+    {
+        if(quick && count > 1000)
+        {
+            break;
+        }
+
+        ste::timer_service service;
+        service.reserve(count);
+
+        footprint_case("service,timers=" + std::to_string(count), count, [&]()
+        {
+            return std::make_unique<ste::hour_timer<function_t>>(service, []() {}, 1, 0, false);
+        });
+    }
+
+    // One thread per timer: larger counts exceed the usual thread limits.
+    footprint_case("timer,timers=1000", 1000, []()
+    {
+        return std::make_unique<ste::hour_timer<function_t>>([]() {}, 1, 0, false);
+    });
+}
+
+/*********************************************************************/
+/*                           Callback swap                           */
+/*********************************************************************/
+
+/// Reports the cost of set_function(), idle and while the timer fires every 100us.
+void swap()
+{
+    const std::uint64_t cycles = quick ? 10000 : 100000;
+
+    ste::us_timer<function_t> t([]() {}, 100, 0, false);
+
+    const auto measure = [&]()
+    {
+        const auto begin = std::chrono::steady_clock::now();
+
+        for(std::uint64_t i = 0; i < cycles; ++i)
+        {
+            t.set_function([i]() { (void)i; });
+        }
+
+        return ns_per(std::chrono::steady_clock::now() - begin, cycles);
+    };
+
+    report("swap", "stopped", "set_function", measure(), "ns");
+
+    t.start();
+    report("swap", "interval=100us", "set_function", measure(), "ns");
+    t.stop();
+}
+
+/*********************************************************************/
+/*                              Timeouts                             */
+/*********************************************************************/
+
+/// Cancels a random outstanding expiration and arms a new one, 'outstanding' being pending.
+template<typename handle_t, typename arm_f>
+double cancel_rearm(ste::timer_service& service, const std::size_t outstanding, const std::uint64_t cycles, arm_f arm)
+{
+    std::vector<handle_t> handles(outstanding);
+    std::mt19937 random(42);
+
+    for(auto& h : handles)
+    {
+        h = arm();
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    for(std::uint64_t i = 0; i < cycles; ++i)
+    {
+        auto& h = handles[random() % outstanding];
+        service.cancel(h);
+        h = arm();
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    for(const auto h : handles)
+    {
+        service.cancel(h);
+    }
+
+    return ns_per(elapsed, cycles);
+}
+
+/// Reports the cost of a cancel() + re-arm pair, with timeouts and with regular expirations.
+void timeout()
+{
+    const std::uint64_t cycles = quick ? 100000 : 2000000;
+
+    for(const std::size_t outstanding : {std::size_t(1), std::size_t(100000)})
+    {
+        ste::timer_service service;
+        service.reserve(outstanding);
+
+        const std::string parameter = "outstanding=" + std::to_string(outstanding);
+
+        report("timeout", parameter, "schedule_timeout_cancel",
+               cancel_rearm<ste::timer_service::timeout_handle>(service, outstanding, cycles, [&]()
+               {
+                   return service.schedule_timeout(std::chrono::seconds(30), []() {});
+               }), "ns");
+
+        report("timeout", parameter, "schedule_after_cancel",
+               cancel_rearm<ste::timer_service::id>(service, outstanding, cycles, [&]()
+               {
+                   return service.schedule_after(std::chrono::seconds(30), []() {});
+               }), "ns");
+    }
+}
+
+/*********************************************************************/
+/*                              Scaling                              */
+/*********************************************************************/
+
+/// Returns the number of timeout arm + cancel pairs per second, over 'threads' threads.
+template<typename service_t>
+double arm_cancel_rate(service_t& service, const std::size_t threads, const std::chrono::milliseconds duration)
+{
+    std::atomic<bool> go   = false;
+    std::atomic<bool> stop = false;
+    std::atomic<std::uint64_t> total = 0;
+    std::vector<std::thread> workers;
+
+    for(std::size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            while(!go.load()) { std::this_thread::yield(); }
+
+            std::uint64_t pairs = 0;
+
+            while(!stop.load(std::memory_order_relaxed))
+            {
+                service.cancel(service.schedule_timeout(std::chrono::seconds(30), []() {}));
+                ++pairs;
+            }
+
+            total += pairs;
+        });
+    }
+
+    go = true;
+    std::this_thread::sleep_for(duration);
+    stop = true;
+
+    for(auto& w : workers)
+    {
+        w.join();
+    }
+
+    return static_cast<double>(total.load()) / std::chrono::duration<double>(duration).count();
+}
+
+/// Reports the arm / cancel throughput of one service and of a sharded service, from 1 to N threads.
+void scaling()
+{
+    const auto duration = quick ? std::chrono::milliseconds(100) : std::chrono::milliseconds(500);
+    const std::size_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+
+    ste::timer_service single;
+    ste::sharded_timer_service sharded;
+
+    for(std::size_t threads = 1; ; threads = std::min(threads * 2, cpus))
+    {
+        const std::string parameter = "threads=" + std::to_string(threads);
+
+        report("scaling", parameter, "timer_service", arm_cancel_rate(single, threads, duration), "1/s");
+        report("scaling", parameter, "sharded_timer_service", arm_cancel_rate(sharded, threads, duration), "1/s");
+
+        if(threads == cpus)
+        {
+            break;
+        }
+    }
+}
+
+void print_csv()
+{
+    std::cout << "case,parameter,metric,value,unit\n";
+
+    for(const auto& r : results)
+    {
+        std::cout << r.bench << ",\"" << r.parameter << "\"," << r.metric << "," << r.value << "," << r.unit << "\n";
+    }
+}
+
+void print_json()
+{
+    std::cout << "{\n  \"results\": [\n";
+
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& r = results[i];
+
+        std::cout << "    {\"case\": \"" << r.bench << "\", \"parameter\": \"" << r.parameter
+                  << "\", \"metric\": \"" << r.metric << "\", \"value\": " << r.value
+                  << ", \"unit\": \"" << r.unit << "\"}" << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+
+    std::cout << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    std::vector<std::string> cases;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if(arg == "--json")
+        {
+            json = true;
+        }
+        else if(arg == "--quick")
+        {
+            quick = true;
+        }
+        else
+        {
+            cases.push_back(arg);
+        }
+    }
+
+    const auto selected = [&](const std::string& name)
+    {
+        return cases.empty() || std::find(cases.begin(), cases.end(), name) != cases.end();
+    };
+
+    if(selected("jitter"))      { jitter(); }
+    if(selected("throughput"))  { throughput(); }
+    if(selected("churn"))       { churn(); }
+    if(selected("footprint"))   { footprint(); }
+    if(selected("swap"))        { swap(); }
+    if(selected("timeout"))     { timeout(); }
+    if(selected("scaling"))     { scaling(); }
+
+    json ? print_json() : print_csv();
+
+    return EXIT_SUCCESS;
+}
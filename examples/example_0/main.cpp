@@ -32,21 +32,21 @@
     SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#include "../../include/timer.hpp"
+#include "../../include/inplace_function.hpp"
 
-#include <functional>
+#include "../../include/timer.hpp"
 
 #include <iostream>
 
 int main()
 {
-    const std::function<void(void)> f1 = []()
+    const ste::inplace_function<void(void)> f1 = []()
     {
         static std::uint64_t count = 0;
         std::cout << ++count << std::endl;
     };
 
-    ste::ms_timer<std::function<void(void)>> t1(f1, 500, 0, false);
+    ste::ms_timer<ste::inplace_function<void(void)>> t1(f1, 500, 0, false);
 
     {
         std::cout << t1 << std::endl;
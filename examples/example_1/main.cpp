@@ -34,29 +34,31 @@
 */
 
 
+#include "../../include/inplace_function.hpp"
+
 #include "../../include/timer.hpp"
 
 #include <chrono>
 
-#include <functional>
-
 #include <iostream>
 
 int main()
 {
-    const std::function<void(void)> f1 = []()
+    const ste::inplace_function<void(void)> f1 = []()
     {
         std::cout << "f1" << std::endl;
     };
 
-    ste::ms_timer<std::function<void(void)>> t1(f1, 500, 0, false);
+    ste::ms_timer<ste::inplace_function<void(void)>> t1(f1, 500, 0, false);
 
-    const std::function<void(void)> f2 = []()
+    const ste::inplace_function<void(void)> f2 = []()
     {
         std::cout << "f2" << std::endl;
     };
 
-    const std::function f3 = [f1, f2, &t1]()
+    // Holds copies of f1 and f2, 64 bytes each: too large for the default capacity of 48 bytes.
+    // Init-captures, as plain copies of const variables would be const, thus not nothrow movable.
+    const ste::inplace_function<void(void), 160> f3 = [f1 = f1, f2 = f2, &t1]()
     {
         static bool b = false;
 
@@ -64,7 +66,7 @@ int main()
         b = !b;
     };
 
-    ste::ms_timer<std::function<void(void)>> t2(f3, 1000, 0, false);
+    ste::ms_timer<ste::inplace_function<void(void), 160>> t2(f3, 1000, 0, false);
 
     {
         std::cout << t1 << std::endl;
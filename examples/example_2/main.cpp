@@ -0,0 +1,83 @@
+/*
+                        ste::timer example 2
+
+                 This example demonstrates how to
+                 run many timers from a single thread
+                 using a ste::timer_service.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../include/inplace_function.hpp"
+
+#include "../../include/timer.hpp"
+
+#include <atomic>
+
+#include <iostream>
+
+#include <memory>
+
+#include <vector>
+
+int main()
+{
+    // One dispatcher thread serves every timer below.
+    ste::timer_service service;
+
+    std::atomic<std::uint64_t> count = 0;
+
+    const ste::inplace_function<void(void)> f1 = [&count]()
+    {
+        ++count;
+    };
+
+    std::vector<std::unique_ptr<ste::ms_timer<ste::inplace_function<void(void)>>>> timers;
+
+    for(std::uint64_t i = 0; i < 1000; ++i)
+    {
+        timers.push_back(std::make_unique<ste::ms_timer<ste::inplace_function<void(void)>>>(service, f1, 100, i % 100, false));
+    }
+
+    {
+        std::cout << *timers.front() << std::endl;
+
+        for(auto& t : timers)
+        {
+            t->start();
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    timers.clear();
+
+    std::cout << count << " calls from " << service.thread_count() << " thread(s)." << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+                        ste::timer example 3
+
+                 This example demonstrates how to
+                 drive timers from an existing epoll loop,
+                 without any timer thread (Linux only).
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../include/inplace_function.hpp"
+
+#include "../../include/timer.hpp"
+
+#include "../../include/timerfd_timer.hpp"
+
+#include <sys/epoll.h>
+
+#include <unistd.h>
+
+#include <iostream>
+
+int main()
+{
+    const int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+
+    // A timer with its own timerfd.
+    ste::timerfd_timer<ste::inplace_function<void(void)>, std::chrono::milliseconds, std::chrono::milliseconds>
+        t1([]() { std::cout << "t1" << std::endl; }, 500, 0, false);
+
+    // Any number of timers multiplexed on the timerfd of a 0-thread service.
+    ste::timer_service service(0);
+    ste::ms_timer<ste::inplace_function<void(void)>> t2(service, []() { std::cout << "t2" << std::endl; }, 1000, 0, false);
+    ste::ms_timer<ste::inplace_function<void(void)>> t3(service, []() { std::cout << "t3" << std::endl; }, 250, 1000, true);
+
+    epoll_event event = {};
+    event.events      = EPOLLIN;
+
+    event.data.fd = t1.fd();
+    ::epoll_ctl(epoll, EPOLL_CTL_ADD, t1.fd(), &event);
+
+    event.data.fd = service.fd();
+    ::epoll_ctl(epoll, EPOLL_CTL_ADD, service.fd(), &event);
+
+    t1.start();
+    t2.start();
+    t3.start();
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+
+    while(std::chrono::steady_clock::now() < end)
+    {
+        epoll_event ready[2];
+        const int count = ::epoll_wait(epoll, ready, 2, 100);
+
+        for(int i = 0; i < count; ++i)
+        {
+            if(ready[i].data.fd == t1.fd())
+            {
+                t1.dispatch_ready();
+            }
+            else
+            {
+                service.dispatch_ready();
+            }
+        }
+    }
+
+    ::close(epoll);
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+                        ste::timer example 4
+
+                 This example demonstrates how to
+                 wait in C++20 coroutines without
+                 blocking any thread.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../include/coroutine.hpp"
+
+#include "../../include/thread_pool.hpp"
+
+#include <atomic>
+
+#include <coroutine>
+
+#include <exception>
+
+#include <iostream>
+
+#include <thread>
+
+/// Minimal fire-and-forget coroutine type. Use the task type of your framework instead.
+struct detached
+{
+    struct promise_type
+    {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+std::atomic<int> running = 0;
+
+detached countdown(ste::executor_ref pool)
+{
+    ++running;
+
+    for(int i = 3; i > 0; --i)
+    {
+        std::cout << "countdown: " << i << std::endl;
+        co_await ste::sleep_for(std::chrono::milliseconds(500), pool); // Resumes on the pool.
+    }
+
+    std::cout << "countdown: done" << std::endl;
+    --running;
+}
+
+detached heartbeat()
+{
+    ++running;
+
+    auto ticks = ste::every(std::chrono::milliseconds(250)); // Resumes on the service's dispatcher.
+
+    for(;;)
+    {
+        const ste::tick t = co_await ticks.next();
+        std::cout << "heartbeat " << t.index << " (missed " << t.missed << ")" << std::endl;
+
+        if(t.index == 8)
+        {
+            break;
+        }
+    }
+
+    co_await ste::sleep_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+    std::cout << "heartbeat: done" << std::endl;
+    --running;
+}
+
+int main()
+{
+    ste::thread_pool pool(2);
+
+    countdown(pool);
+    heartbeat();
+
+    while(running != 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return 0;
+}
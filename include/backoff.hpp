@@ -0,0 +1,148 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_backoff_HPP
+#define STE_backoff_HPP
+
+#include <algorithm>
+
+#include <chrono>
+
+#include <type_traits>
+
+#include <utility>
+
+namespace ste
+{
+
+/**
+                                ste::backoff
+
+    @short Adaptive interval for polling timers: exponential backoff while idle, reset on work.
+
+    @details
+    Wraps a poll function that returns 'true' when it found work. Each call returns the interval
+    before the next poll: 'min' after work was found, otherwise the previous interval times
+    'factor', up to 'max'. Used as the function of a ste::timer, which waits the returned
+    interval instead of interval(), and passes it back to the next call (see ste::timer):
+
+        ste::timer<ste::backoff<poll_t>, std::chrono::milliseconds, std::chrono::milliseconds>
+            t(ste::backoff(poll, std::chrono::milliseconds(1), std::chrono::milliseconds(100)),
+              std::chrono::milliseconds(1), {}, false, true);
+
+    A busy poller runs every 'min', an idle one slows down to one poll every 'max'. Each start()
+    of the timer restarts from 'min'.
+
+    The previous interval is kept by the timer, not by the backoff, which calls never modify:
+    the timer's function() may copy it while it runs. The poll function is called from the
+    timer thread only, and is copied along with the backoff.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename poll_t>
+class backoff
+{
+    static_assert (std::is_invocable_r<bool, poll_t&>::value, "ste::backoff poll function must return 'true' when it found work." );
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    poll_t _poll;
+
+    std::chrono::nanoseconds _min;
+    std::chrono::nanoseconds _max;
+    double _factor;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param poll Function to call. Returns 'true' if it found work.
+     *  @param min Interval after work was found.
+     *  @param max Longest interval.
+     *  @param factor (optional) Growth of the interval after each idle poll. Default is 2.
+     */
+    inline backoff(poll_t poll,
+                   const std::chrono::nanoseconds min,
+                   const std::chrono::nanoseconds max,
+                   const double factor = 2.0)
+        :
+          _poll(std::move(poll)),
+          _min(std::max(min, std::chrono::nanoseconds::zero())),
+          _max(std::max(max, _min)),
+          _factor(std::max(factor, 1.0))
+    {}
+
+    /*********************************************************************/
+    /*                            Operators                              */
+    /*********************************************************************/
+
+    /**
+     *  @brief  Polls, then returns the interval before the next poll.
+     *  @param  previous Interval returned by the previous call. Zero, or below 'min', restarts from 'min'.
+     */
+    inline std::chrono::nanoseconds operator()(const std::chrono::nanoseconds previous)
+    {
+        if(_poll())
+        {
+            return _min;
+        }
+
+        // In floating point: the product may not fit in an integer before being capped.
+        const double next = std::max(static_cast<double>(std::max(previous, _min).count()), 1.0) * _factor;
+
+        return next >= static_cast<double>(_max.count()) ? _max : std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(next));
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Returns the interval after work was found.
+    inline std::chrono::nanoseconds min() const
+    {
+        return _min;
+    }
+
+    /// Returns the longest interval.
+    inline std::chrono::nanoseconds max() const
+    {
+        return _max;
+    }
+};
+
+} //namespace ste
+#endif //STE_backoff_HPP
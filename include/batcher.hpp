@@ -0,0 +1,424 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_batcher_HPP
+#define STE_batcher_HPP
+
+#include "inplace_function.hpp"
+
+#include "timer_service.hpp"
+
+#include <algorithm>
+
+#include <atomic>
+
+#include <cstddef>
+
+#include <cstdint>
+
+#include <memory>
+
+#include <mutex>
+
+#include <type_traits>
+
+#include <utility>
+
+#include <vector>
+
+namespace ste
+{
+
+/**
+                                ste::batcher
+
+    @short Collects items from any number of producers and hands them to a consumer function
+           in batches, when a batch is full or when the interval has elapsed, whichever comes first.
+
+    @details
+    Features:
+        • push() never allocates: items go to a lock-free, bounded multi-producer,
+          single-consumer ring (D. Vyukov's bounded queue), and only the push that fills
+          a batch takes a lock, to move the flush forward. push() fails if the ring is full.
+        • The function receives at most max_batch() items per call. Under heavy load every
+          batch is full; under light load an item waits at most interval() (plus the
+          service's latency) before it is handed over.
+        • The interval restarts after each flush, whatever triggered it.
+        • The function runs on a ste::timer_service dispatcher, never concurrently with itself.
+          Without a service, the batcher creates a 1-thread service of its own.
+        • The destructor hands the remaining items over before returning.
+
+    'item_t' must be default-constructible and move-assignable. The function is called with a
+    std::vector<item_t>& it may move the items out of; the vector is reused for the next batch.
+
+        ste::batcher<record> b([](std::vector<record>& batch) { write(batch); }, 512, std::chrono::milliseconds(20));
+        b.push(r); // From any thread.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename item_t,
+         typename function_t = inplace_function<void(std::vector<item_t>&)>
+         >
+class batcher
+{
+    static_assert (std::is_invocable<function_t, std::vector<item_t>&>::value, "ste::batcher function must be invocable with a std::vector<item_t>&." );
+    static_assert (std::is_default_constructible<item_t>::value, "ste::batcher items must be default-constructible." );
+
+public:
+
+    using duration = timer_service::duration;
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    /// Ring slot. 'sequence' tells whose turn it is: producer of position 'sequence', or consumer of 'sequence' - 1.
+    struct cell
+    {
+        std::atomic<std::size_t> sequence;
+        item_t item;
+    };
+
+    /// Ring of capacity() cells.
+    std::unique_ptr<cell[]> _cells;
+
+    /// capacity() - 1.
+    std::size_t _mask;
+
+    /// Next position to write. Claimed by producers with a CAS.
+    alignas(64) std::atomic<std::size_t> _enqueue_pos = 0;
+
+    /// Next position to read. Only used by the consumer.
+    alignas(64) std::size_t _dequeue_pos = 0;
+
+    /// Items pushed (or being pushed) and not yet handed over. Reserved before a push, so never below the ring's content.
+    alignas(64) std::atomic<std::size_t> _size = 0;
+
+    const std::size_t _max_batch;
+    const duration _interval;
+
+    /// Function to call with each batch.
+    function_t _function;
+
+    /// Batch handed to _function. Reused.
+    std::vector<item_t> _batch;
+
+    /// Service created when none is given.
+    std::unique_ptr<timer_service> _own_service;
+
+    /// Service the flushes run on.
+    timer_service* _service;
+
+    /// Protects _flush_id, _flush_requested and _closing.
+    std::mutex _arm_mutex;
+
+    /// Pending flush. 0 once the batcher is closing.
+    timer_service::id _flush_id = 0;
+
+    /// Set when a full batch was signalled while a flush was running: the next flush is immediate.
+    bool _flush_requested = false;
+
+    /// Set by the destructor.
+    bool _closing = false;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param service Service the function runs on. Must outlive the batcher.
+     *  @param function Function to call with each batch.
+     *  @param max_batch Maximum number of items per batch. A full batch is handed over immediately.
+     *  @param interval Maximum time between two flushes.
+     *  @param capacity (optional) Number of items the batcher can hold, rounded up to a power of 2.
+     *                             Default is 0, for 4 * max_batch.
+     */
+    inline batcher(timer_service& service,
+                   function_t function,
+                   const std::size_t max_batch,
+                   const duration interval,
+                   const std::size_t capacity = 0)
+        : batcher(nullptr, &service, std::move(function), max_batch, interval, capacity)
+    {}
+
+    /**
+     *  @brief Constructor. The function runs on a 1-thread service owned by the batcher.
+     *  @param function Function to call with each batch.
+     *  @param max_batch Maximum number of items per batch. A full batch is handed over immediately.
+     *  @param interval Maximum time between two flushes.
+     *  @param capacity (optional) Number of items the batcher can hold, rounded up to a power of 2.
+     *                             Default is 0, for 4 * max_batch.
+     */
+    inline batcher(function_t function,
+                   const std::size_t max_batch,
+                   const duration interval,
+                   const std::size_t capacity = 0)
+        : batcher(std::make_unique<timer_service>(1), nullptr, std::move(function), max_batch, interval, capacity)
+    {}
+
+    /// Destructor. Hands the remaining items over on the calling thread. No push() may be in progress.
+    inline ~batcher()
+    {
+        timer_service::id pending = 0;
+
+        {
+            std::lock_guard lock(_arm_mutex);
+            _closing = true;
+            std::swap(pending, _flush_id);
+        }
+
+        // Outside of the lock: cancel() waits for a running on_flush(), which locks it.
+        _service->cancel(pending);
+
+        while(drain() != 0) {}
+    }
+
+    batcher(const batcher&)            = delete;
+    batcher(batcher&&)                 = delete;
+    batcher& operator=(const batcher&) = delete;
+    batcher& operator=(batcher&&)      = delete;
+
+    /*********************************************************************/
+    /*                             Producers                             */
+    /*********************************************************************/
+
+    /**
+     *  @brief  Queues 'item'. Callable from any thread.
+     *  @return 'false' if the batcher is full, in which case 'item' is left untouched.
+     */
+    inline bool push(item_t&& item)
+    {
+        return emplace(std::move(item));
+    }
+
+    /// @overload
+    inline bool push(const item_t& item)
+    {
+        return emplace(item);
+    }
+
+    /// Hands the queued items over as soon as possible, without waiting for the interval.
+    inline void flush()
+    {
+        request_flush();
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Returns the number of queued items. Approximate while items are pushed or handed over.
+    inline std::size_t size() const
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    /// Returns the maximum number of items the batcher can hold.
+    inline std::size_t capacity() const
+    {
+        return _mask + 1;
+    }
+
+    /// Returns the maximum number of items per batch.
+    inline std::size_t max_batch() const
+    {
+        return _max_batch;
+    }
+
+    /// Returns the maximum time between two flushes.
+    inline duration interval() const
+    {
+        return _interval;
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// Runs on 'service', or on 'own_service' if 'service' is nullptr.
+    inline batcher(std::unique_ptr<timer_service> own_service,
+                   timer_service* const service,
+                   function_t function,
+                   const std::size_t max_batch,
+                   const duration interval,
+                   const std::size_t capacity)
+        :
+          _max_batch(std::max<std::size_t>(max_batch, 1)),
+          _interval(std::max(interval, duration::zero())),
+          _function(std::move(function)),
+          _own_service(std::move(own_service)),
+          _service(service != nullptr ? service : _own_service.get())
+    {
+        std::size_t size = 2;
+
+        while(size < (capacity == 0 ? _max_batch * 4 : capacity))
+        {
+            size *= 2;
+        }
+
+        _cells = std::make_unique<cell[]>(size);
+        _mask  = size - 1;
+
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        _batch.reserve(_max_batch);
+
+        std::lock_guard lock(_arm_mutex);
+        _flush_id = _service->schedule_after(_interval, [this]() { on_flush(); });
+    }
+
+    template<typename value_t>
+    inline bool emplace(value_t&& item)
+    {
+        // Reserved first, so that the consumer never sees more items than _size.
+        const std::size_t previous = _size.fetch_add(1, std::memory_order_acq_rel);
+
+        cell* c;
+        std::size_t position = _enqueue_pos.load(std::memory_order_relaxed);
+
+        for(;;)
+        {
+            c = &_cells[position & _mask];
+
+            const std::size_t sequence = c->sequence.load(std::memory_order_acquire);
+            const auto difference      = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if(difference == 0)
+            {
+                if(_enqueue_pos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(difference < 0)
+            {
+                _size.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        c->item = std::forward<value_t>(item);
+        c->sequence.store(position + 1, std::memory_order_release);
+
+        if(previous + 1 == _max_batch)
+        {
+            request_flush();
+        }
+
+        return true;
+    }
+
+    /// Consumer side. Requires being the only consumer.
+    inline bool pop(item_t& item)
+    {
+        cell& c = _cells[_dequeue_pos & _mask];
+
+        if(c.sequence.load(std::memory_order_acquire) != _dequeue_pos + 1)
+        {
+            return false;
+        }
+
+        item = std::move(c.item);
+        c.sequence.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+        ++_dequeue_pos;
+
+        return true;
+    }
+
+    /// Hands at most one batch over. Returns its size.
+    inline std::size_t drain()
+    {
+        _batch.clear();
+
+        item_t item;
+
+        while(_batch.size() < _max_batch && pop(item))
+        {
+            _batch.push_back(std::move(item));
+        }
+
+        const std::size_t count = _batch.size();
+
+        if(count != 0)
+        {
+            _size.fetch_sub(count, std::memory_order_acq_rel);
+            _function(_batch);
+        }
+
+        return count;
+    }
+
+    /// Moves the pending flush to now. If it is running, the next one will be immediate.
+    inline void request_flush()
+    {
+        std::lock_guard lock(_arm_mutex);
+
+        if(_flush_id != 0 && !_service->reschedule(_flush_id, timer_service::clock::now()))
+        {
+            _flush_requested = true;
+        }
+    }
+
+    /// Flush handler. Hands one batch over, then arms the next flush.
+    inline void on_flush()
+    {
+        drain();
+
+        std::lock_guard lock(_arm_mutex);
+
+        if(_closing)
+        {
+            return;
+        }
+
+        // One batch per call, so that a busy batcher does not starve the other timers of the service.
+        const bool immediate = _flush_requested || _size.load(std::memory_order_acquire) >= _max_batch;
+        _flush_requested     = false;
+
+        const auto now = timer_service::clock::now();
+        _flush_id      = _service->schedule_at(immediate ? now : now + _interval, [this]() { on_flush(); });
+    }
+};
+
+} //namespace ste
+#endif //STE_batcher_HPP
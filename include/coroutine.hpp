@@ -0,0 +1,345 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_coroutine_HPP
+#define STE_coroutine_HPP
+
+// C++20 layer: empty when compiled as C++17.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include "executor.hpp"
+
+#include "timer_service.hpp"
+
+#include <algorithm>
+
+#include <atomic>
+
+#include <chrono>
+
+#include <coroutine>
+
+#include <cstdint>
+
+#include <thread>
+
+namespace ste
+{
+
+/// Returns the service shared by the awaitables of this header when none is given. One dispatcher thread.
+inline timer_service& default_timer_service()
+{
+    static timer_service service;
+    return service;
+}
+
+namespace detail
+{
+
+/// Resumes 'handle' on 'executor', or on the calling thread if it is null.
+inline void resume_on(const executor_ref executor, const std::coroutine_handle<> handle)
+{
+    if(executor)
+    {
+        executor.execute([handle]() { handle.resume(); });
+    }
+    else
+    {
+        handle.resume();
+    }
+}
+
+/**
+ *  @brief Resumption of a suspended coroutine by a ste::timer_service timeout. Member of the
+ *         awaiters: the timeout is cancelled if the coroutine frame is destroyed first.
+ */
+class scheduled_resume
+{
+    timer_service* _service = nullptr;
+    timer_service::timeout_handle _timeout;
+
+    /// Set once _timeout is written. The resumption waits for it.
+    std::atomic<bool> _armed = false;
+
+public:
+
+    scheduled_resume() = default;
+
+    scheduled_resume(const scheduled_resume&)            = delete;
+    scheduled_resume& operator=(const scheduled_resume&) = delete;
+
+    /// Cancels the resumption if it has not fired: the coroutine is destroyed while suspended.
+    inline ~scheduled_resume()
+    {
+        if(_service != nullptr)
+        {
+            _service->cancel(_timeout); // Never waits. Stale once fired.
+        }
+    }
+
+    /// Resumes 'handle' at 'deadline', on 'executor' if it is not null.
+    inline void schedule(timer_service& service,
+                         const timer_service::time_point deadline,
+                         const executor_ref executor,
+                         const std::coroutine_handle<> handle)
+    {
+        _service = &service;
+        _timeout = service.schedule_timeout(deadline - timer_service::clock::now(), [this, executor, handle]()
+        {
+            // Fired before schedule_timeout() returned: the coroutine, and *this, must outlive
+            // the write of _timeout.
+            while(!_armed.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+
+            resume_on(executor, handle);
+        });
+
+        _armed.store(true, std::memory_order_release);
+    }
+};
+
+} //namespace detail
+
+/**
+                                ste::sleep_awaiter
+
+    @short Suspends a coroutine until a deadline, without blocking any thread.
+
+    @details
+    Returned by ste::sleep_for() and ste::sleep_until(). The coroutine is resumed by a
+    dispatcher of the ste::timer_service, or handed off to the executor if one is given.
+    The service and the executor must outlive the suspension. Destroying the suspended
+    coroutine cancels its resumption, but not while it is being resumed.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class sleep_awaiter
+{
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    timer_service* _service;
+    timer_service::time_point _deadline;
+    executor_ref _executor;
+
+    detail::scheduled_resume _resume;
+
+public:
+
+    inline sleep_awaiter(timer_service& service, const timer_service::time_point deadline, const executor_ref executor) noexcept
+        :
+          _service(&service),
+          _deadline(deadline),
+          _executor(executor)
+    {}
+
+    /*********************************************************************/
+    /*                              Awaiter                              */
+    /*********************************************************************/
+
+    inline bool await_ready() const noexcept
+    {
+        return _deadline <= timer_service::clock::now();
+    }
+
+    inline void await_suspend(const std::coroutine_handle<> handle)
+    {
+        _resume.schedule(*_service, _deadline, _executor, handle);
+    }
+
+    inline void await_resume() const noexcept {}
+};
+
+/**
+ *  @brief Suspends the calling coroutine for 'duration'.
+ *  @param executor (optional) Executor the coroutine resumes on. Default is the dispatcher of 'service'.
+ *  @param service (optional) Service that times the wait. Default is ste::default_timer_service().
+ */
+template<typename rep_t, typename period_t>
+inline sleep_awaiter sleep_for(const std::chrono::duration<rep_t, period_t> duration,
+                               const executor_ref executor = {},
+                               timer_service& service      = default_timer_service())
+{
+    return {service, timer_service::clock::now() + std::chrono::ceil<timer_service::duration>(duration), executor};
+}
+
+/**
+ *  @brief Suspends the calling coroutine until 'deadline'.
+ *  @param executor (optional) Executor the coroutine resumes on. Default is the dispatcher of 'service'.
+ *  @param service (optional) Service that times the wait. Default is ste::default_timer_service().
+ */
+template<typename duration_t>
+inline sleep_awaiter sleep_until(const std::chrono::time_point<timer_service::clock, duration_t> deadline,
+                                 const executor_ref executor = {},
+                                 timer_service& service      = default_timer_service())
+{
+    return {service, std::chrono::ceil<timer_service::duration>(deadline), executor};
+}
+
+/// One tick of a ste::periodic.
+struct tick
+{
+    std::uint64_t index;                ///< Number of ticks since the start, this one included.
+    timer_service::time_point deadline; ///< Scheduled time of this tick.
+    std::uint64_t missed;               ///< Ticks skipped just before this one, because the coroutine was late.
+};
+
+/**
+                                ste::periodic
+
+    @short Asynchronous sequence of ticks at absolute deadlines (start + k * interval).
+
+    @details
+    Returned by ste::every(). C++20 has no 'for co_await', so the ticks are awaited one by one:
+
+        auto ticks = ste::every(std::chrono::milliseconds(100));
+        for(;;)
+        {
+            const ste::tick t = co_await ticks.next();
+        }
+
+    If the coroutine falls behind, the missed deadlines are skipped and reported in tick::missed
+    (like ste::period_mode::skip). Not thread-safe: one coroutine awaits a ste::periodic at a time.
+    Destroying a coroutine suspended on next() cancels its resumption, as with ste::sleep_for().
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class periodic
+{
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    timer_service* _service;
+    timer_service::duration _interval;
+    executor_ref _executor;
+
+    /// Deadline of the next tick.
+    timer_service::time_point _next;
+
+    /// Index of the next tick.
+    std::uint64_t _index = 1;
+
+    /// Awaits the next tick of a ste::periodic.
+    class awaiter
+    {
+        periodic* _owner;
+        tick _tick;
+        detail::scheduled_resume _resume;
+
+    public:
+
+        inline explicit awaiter(periodic& owner) noexcept
+            :
+              _owner(&owner),
+              _tick(owner.advance())
+        {}
+
+        inline bool await_ready() const noexcept
+        {
+            return _tick.deadline <= timer_service::clock::now();
+        }
+
+        inline void await_suspend(const std::coroutine_handle<> handle)
+        {
+            _resume.schedule(*_owner->_service, _tick.deadline, _owner->_executor, handle);
+        }
+
+        inline tick await_resume() const noexcept
+        {
+            return _tick;
+        }
+    };
+
+public:
+
+    inline periodic(timer_service& service, const timer_service::duration interval, const executor_ref executor) noexcept
+        :
+          _service(&service),
+          _interval(std::max(interval, timer_service::duration(1))),
+          _executor(executor),
+          _next(timer_service::clock::now() + _interval)
+    {}
+
+    /// Returns an awaitable that completes at the next tick, and yields it.
+    inline awaiter next()
+    {
+        return awaiter(*this);
+    }
+
+    /// Returns the interval between two ticks.
+    inline timer_service::duration interval() const noexcept
+    {
+        return _interval;
+    }
+
+private:
+
+    /// Returns the next tick, skipping the deadlines already passed, and moves to the following one.
+    inline tick advance()
+    {
+        const auto now = timer_service::clock::now();
+        std::uint64_t missed = 0;
+
+        if(_next + _interval <= now)
+        {
+            missed = static_cast<std::uint64_t>((now - _next) / _interval);
+            _next  += _interval * missed;
+            _index += missed;
+        }
+
+        const tick result = {_index, _next, missed};
+
+        _next += _interval;
+        ++_index;
+
+        return result;
+    }
+};
+
+/**
+ *  @brief Returns an asynchronous sequence of ticks every 'interval', the first one 'interval' from now.
+ *  @param executor (optional) Executor the coroutine resumes on. Default is the dispatcher of 'service'.
+ *  @param service (optional) Service that times the ticks. Default is ste::default_timer_service().
+ */
+template<typename rep_t, typename period_t>
+inline periodic every(const std::chrono::duration<rep_t, period_t> interval,
+                      const executor_ref executor = {},
+                      timer_service& service      = default_timer_service())
+{
+    return {service, std::chrono::ceil<timer_service::duration>(interval), executor};
+}
+
+} //namespace ste
+
+#endif //defined(__cpp_impl_coroutine)
+#endif //STE_coroutine_HPP
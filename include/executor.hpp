@@ -0,0 +1,125 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_executor_HPP
+#define STE_executor_HPP
+
+#include "inplace_function.hpp"
+
+#include <cstddef>
+
+#include <type_traits>
+
+#include <utility>
+
+namespace ste
+{
+
+/**
+                                ste::executor_ref
+
+    @short Non-owning, type-erased reference to an executor.
+
+    @details
+    An executor is any object with a member function
+        void execute(ste::executor_ref::task_t task);
+    that runs 'task' at some point, on any thread. ste::thread_pool is one.
+
+    Used by ste::timer to hand its function off instead of calling it on the timer thread.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class executor_ref
+{
+public:
+
+    using task_t = inplace_function<void(void)>;
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    /// Referenced executor.
+    void* _executor = nullptr;
+
+    /// Calls _executor->execute().
+    void (*_execute)(void*, task_t&&) = nullptr;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /// Constructs a null reference.
+    inline executor_ref() noexcept = default;
+
+    /// Constructs a null reference.
+    inline executor_ref(std::nullptr_t) noexcept {}
+
+    /// References 'executor', which must outlive every copy of this reference.
+    template<typename executor_t,
+             typename = std::enable_if_t<!std::is_same_v<std::decay_t<executor_t>, executor_ref>>>
+    inline executor_ref(executor_t& executor) noexcept
+        :
+          _executor(std::addressof(executor)),
+          _execute([](void* e, task_t&& task) { static_cast<executor_t*>(e)->execute(std::move(task)); })
+    {}
+
+    /*********************************************************************/
+    /*                            Operators                              */
+    /*********************************************************************/
+
+    /// Submits 'task' to the referenced executor. The reference must not be null.
+    inline void execute(task_t task) const
+    {
+        _execute(_executor, std::move(task));
+    }
+
+    /// Returns 'true' if an executor is referenced.
+    inline explicit operator bool() const noexcept
+    {
+        return _executor != nullptr;
+    }
+
+    inline friend bool operator==(const executor_ref& a, const executor_ref& b) noexcept
+    {
+        return a._executor == b._executor;
+    }
+
+    inline friend bool operator!=(const executor_ref& a, const executor_ref& b) noexcept
+    {
+        return !(a == b);
+    }
+};
+
+} //namespace ste
+#endif //STE_executor_HPP
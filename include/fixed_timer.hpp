@@ -0,0 +1,434 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_fixed_timer_HPP
+#define STE_fixed_timer_HPP
+
+#include "rcu_cell.hpp"
+
+#include "thread_attributes.hpp"
+
+#include "timer.hpp"
+
+#include <chrono>
+
+#include <condition_variable>
+
+#include <cstdint>
+
+#include <mutex>
+
+#include <ostream>
+
+#include <thread>
+
+#include <type_traits>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+
+#include <sys/syscall.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+
+#include <climits>
+
+#include <ctime>
+#endif
+
+namespace ste
+{
+
+/// Whether a ste::fixed_timer calls its function once or periodically.
+enum class shot
+{
+    single,     ///< One call, 'period' after start().
+    periodic    ///< A call every 'period' after start(), until stop().
+};
+
+/// What a ste::fixed_timer allows to change at runtime.
+enum class mutability
+{
+    none,       ///< Nothing: the function is called directly, without any indirection.
+    function    ///< set_function() is available (see ste::rcu_cell).
+};
+
+/**
+                                ste::fixed_timer
+
+    @short Timer whose period, shot mode and mutability are compile-time parameters.
+
+    @details
+    Features:
+        • The period is 'count' ticks of 'period_t', any std::chrono::duration:
+              ste::fixed_timer<f_t, std::chrono::milliseconds, 1, ste::shot::periodic>
+          (std::chrono::duration is not a structural type, so '1ms' cannot be passed directly.)
+        • The firing loop takes no lock and performs no atomic read-modify-write: deadlines are
+          constants added to the previous deadline, the shot mode is resolved with 'if constexpr',
+          and with mutability::none the function is called directly. On Linux, the thread sleeps
+          on a futex until the deadline and stop() wakes it: the only shared state the loop reads
+          is the stop flag, with relaxed loads. Elsewhere, the sleep is a condition variable wait.
+        • start() and stop() may be called from any thread, concurrently, and from the timer's
+          own function (where start() restarts the schedule once the call returns).
+        • Periodic calls use absolute deadlines (start + k * period); ticks missed because a
+          call overran are skipped, like ste::period_mode::skip.
+        • For anything configurable at runtime, use ste::timer.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename function_t,
+         typename period_t,
+         typename period_t::rep count,
+         ste::shot shot_mode             = ste::shot::periodic,
+         ste::mutability mutability_mode = ste::mutability::none
+         >
+class fixed_timer
+{
+    static_assert (std::is_invocable<function_t>::value, "ste::fixed_timer can only be initialized with an invocable template parameter." );
+    static_assert (detail::is_duration_v<period_t>, "ste::fixed_timer period must be a std::chrono::duration." );
+    static_assert (count > 0, "ste::fixed_timer period must be positive." );
+
+public:
+
+    /// Duration between two calls.
+    static constexpr period_t period = period_t(count);
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    using storage_t = std::conditional_t<mutability_mode == ste::mutability::function, rcu_cell<function_t>, function_t>;
+
+    /// Function to call.
+    storage_t _function;
+
+    /// Values of _state.
+    enum : std::uint32_t
+    {
+        running    = 0,
+        stopping   = 1,
+        restarting = 2  ///< start() from the timer's function.
+    };
+
+    /// What the call loop must do. The futex word the loop sleeps on, on Linux.
+    std::atomic<std::uint32_t> _state = stopping;
+
+    /// Running call loop, if any. Protected by _control_mutex.
+    attributed_thread _thread;
+
+    /// Attributes of the threads created by start(). Protected by _control_mutex.
+    thread_attributes _thread_attributes;
+
+    /// Serialises start(), stop() and set_thread_attributes() outside of the timer's function.
+    mutable std::mutex _control_mutex;
+
+#if !defined(__linux__)
+    /// Interruptible wait of the call loop.
+    std::mutex _wait_mutex;
+    std::condition_variable _wait_cv;
+#endif
+
+    /// Timer whose call loop runs on the calling thread, if any.
+    static inline thread_local const fixed_timer* _current = nullptr;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param function Function to call.
+     *  @param start (optional) Indicates if the timer must be started immediately. Default is false.
+     */
+    inline explicit fixed_timer(function_t function, const bool start = false)
+        : _function(std::move(function))
+    {
+        if(start)
+        {
+            this->start();
+        }
+    }
+
+    /// Destructor. Stops the timer. Must not be called from the timer's function.
+    inline ~fixed_timer()
+    {
+        stop();
+    }
+
+    fixed_timer(const fixed_timer&)            = delete;
+    fixed_timer(fixed_timer&&)                 = delete;
+    fixed_timer& operator=(const fixed_timer&) = delete;
+    fixed_timer& operator=(fixed_timer&&)      = delete;
+
+    /*********************************************************************/
+    /*                         Timer management                          */
+    /*********************************************************************/
+
+    /**
+     *  @brief Starts the timer: the first call happens 'period' from now.
+     *         Restarts the schedule if the timer is already running.
+     *  @note  From the timer's own function, the schedule restarts when the call returns,
+     *         unless stop() was called meanwhile.
+     */
+    inline void start()
+    {
+        if(_current == this)
+        {
+            // Never overwrites 'stopping': stop() would wait for a loop that does not end.
+            std::uint32_t expected = running;
+            _state.compare_exchange_strong(expected, restarting, std::memory_order_relaxed);
+            return;
+        }
+
+        std::lock_guard lock(_control_mutex);
+
+        halt();
+
+        _state.store(running, std::memory_order_relaxed);
+        _thread = attributed_thread(_thread_attributes, [this]() { run(); });
+    }
+
+    /**
+     *  @brief Stops the timer and waits for a call in progress.
+     *  @note  From the timer's own function, only requests the stop.
+     */
+    inline void stop()
+    {
+        if(_current == this)
+        {
+            _state.store(stopping, std::memory_order_relaxed);
+            return;
+        }
+
+        std::lock_guard lock(_control_mutex);
+
+        halt();
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Returns the duration between two calls.
+    static constexpr period_t interval()
+    {
+        return period;
+    }
+
+    /// Returns 'true' if the timer calls its function once.
+    static constexpr bool single_shot()
+    {
+        return shot_mode == ste::shot::single;
+    }
+
+    /// Sets the function called by the timer. Only with ste::mutability::function.
+    template<ste::mutability m = mutability_mode, typename = std::enable_if_t<m == ste::mutability::function>>
+    inline void set_function(function_t function)
+    {
+        _function.store(std::move(function));
+    }
+
+    /// Returns a copy of the function called by the timer.
+    inline function_t function() const
+    {
+        if constexpr(mutability_mode == ste::mutability::function)
+        {
+            return _function.load();
+        }
+        else
+        {
+            return _function;
+        }
+    }
+
+    /**
+     *  @brief Sets the scheduling policy, affinity, stack size and name of the timer thread.
+     *         Takes effect at the next start(). Must not be called from the timer's function.
+     */
+    inline void set_thread_attributes(const thread_attributes& attributes)
+    {
+        std::lock_guard lock(_control_mutex);
+        _thread_attributes = attributes;
+    }
+
+    /// Returns what could not be applied to the thread created by the last start().
+    /// Must not be called from the timer's function.
+    inline thread_attributes_status thread_status() const
+    {
+        std::lock_guard lock(_control_mutex);
+        return _thread.status();
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// Calls the function.
+    inline void call()
+    {
+        if constexpr(mutability_mode == ste::mutability::function)
+        {
+            _function.read([](function_t& f) { f(); });
+        }
+        else
+        {
+            _function();
+        }
+    }
+
+    /// Stops the call loop and joins its thread. Requires _control_mutex, not from the call loop.
+    inline void halt()
+    {
+        _state.store(stopping, std::memory_order_relaxed);
+        wake();
+
+        if(_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    /// Sleeps until 'deadline'. Returns 'false' if the timer was stopped first.
+    inline bool sleep_until(const std::chrono::steady_clock::time_point deadline)
+    {
+#if defined(__linux__)
+        // steady_clock is CLOCK_MONOTONIC, the clock of absolute FUTEX_WAIT_BITSET timeouts.
+        const auto since_epoch = deadline.time_since_epoch();
+        const auto seconds     = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+
+        timespec until = {};
+        until.tv_sec   = static_cast<time_t>(seconds.count());
+        until.tv_nsec  = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - seconds).count());
+
+        for(;;)
+        {
+            if(_state.load(std::memory_order_relaxed) != running)
+            {
+                return false;
+            }
+
+            // Returns at the deadline, on wake(), if _state is not 'running' anymore, or on a signal.
+            if(::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_state), FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                         static_cast<std::uint32_t>(running), &until, nullptr, FUTEX_BITSET_MATCH_ANY) != 0 && errno == ETIMEDOUT)
+            {
+                return _state.load(std::memory_order_relaxed) == running;
+            }
+        }
+#else
+        std::unique_lock lock(_wait_mutex);
+        return !_wait_cv.wait_until(lock, deadline, [this]() { return _state.load(std::memory_order_relaxed) != running; });
+#endif
+    }
+
+    /// Interrupts sleep_until() after _state changed.
+    inline void wake()
+    {
+#if defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_state), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT_MAX, nullptr, nullptr, 0);
+#else
+        {
+            std::lock_guard lock(_wait_mutex);
+        }
+
+        _wait_cv.notify_all();
+#endif
+    }
+
+    /// Call loop.
+    inline void run()
+    {
+        static_assert (sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "ste::fixed_timer sleeps on its state as a futex word." );
+
+        constexpr auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+        static_assert (step.count() > 0, "ste::fixed_timer period must be at least one tick of std::chrono::steady_clock." );
+
+        _current = this;
+
+        auto deadline = std::chrono::steady_clock::now() + step;
+
+        while(sleep_until(deadline))
+        {
+            call();
+
+            // Only changes if the function called start() or stop(), or if stop() is called concurrently.
+            std::uint32_t state = _state.load(std::memory_order_relaxed);
+
+            if(state == restarting)
+            {
+                if(!_state.compare_exchange_strong(state, running, std::memory_order_relaxed))
+                {
+                    break; // Stopped meanwhile.
+                }
+
+                deadline = std::chrono::steady_clock::now() + step;
+                continue;
+            }
+
+            if constexpr(shot_mode == ste::shot::single)
+            {
+                break;
+            }
+
+            deadline += step;
+
+            // Skip the ticks that passed during the call.
+            const auto now = std::chrono::steady_clock::now();
+            if(deadline <= now)
+            {
+                deadline += step * ((now - deadline) / step + 1);
+            }
+        }
+
+        _current = nullptr;
+    }
+
+public:
+
+    /*********************************************************************/
+    /*                            Operators                              */
+    /*********************************************************************/
+
+    inline friend std::ostream& operator<<(std::ostream& out, const fixed_timer&)
+    {
+        return out << "ste::fixed_timer:\n"
+                   << "    Interval: " << count << detail::duration_unit<period_t>() << "\n"
+                   << "    Single-shot: " << single_shot();
+    }
+};
+
+} //namespace ste
+#endif //STE_fixed_timer_HPP
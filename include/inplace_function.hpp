@@ -0,0 +1,268 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_inplace_function_HPP
+#define STE_inplace_function_HPP
+
+#include <cstddef>
+
+#include <functional>
+
+#include <new>
+
+#include <type_traits>
+
+#include <utility>
+
+namespace ste
+{
+
+template<typename signature_t,
+         std::size_t capacity  = 48,
+         std::size_t alignment = alignof(std::max_align_t)>
+class inplace_function;
+
+/**
+                                ste::inplace_function
+
+    @short Type-erased callable stored in a fixed-size inline buffer. Never allocates.
+
+    @details
+    Features:
+        • Drop-in replacement for std::function for callables of at most 'capacity' bytes.
+          Larger callables are rejected at compile time instead of being heap-allocated.
+        • Copying, moving and assigning copy the buffer through a per-type table of
+          function pointers: no allocation, one indirect call to invoke.
+        • With the default parameters, sizeof(ste::inplace_function<void(void)>) is 64 bytes.
+
+    This is the recommended function type for ste::timer:
+        ste::ms_timer<ste::inplace_function<void(void)>> t(f, 500);
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename result_t, typename... args_t, std::size_t capacity, std::size_t alignment>
+class inplace_function<result_t(args_t...), capacity, alignment>
+{
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    /// Operations on the stored callable, one instance per callable type.
+    struct vtable
+    {
+        result_t (*invoke)(void*, args_t&&...);
+        void (*copy)(void* destination, const void* source);
+        void (*move)(void* destination, void* source) noexcept;
+        void (*destroy)(void*) noexcept;
+    };
+
+    template<typename callable_t>
+    static constexpr vtable vtable_for =
+    {
+        [](void* storage, args_t&&... args) -> result_t
+        {
+            if constexpr(std::is_void_v<result_t>)
+            {
+                std::invoke(*static_cast<callable_t*>(storage), std::forward<args_t>(args)...);
+            }
+            else
+            {
+                return std::invoke(*static_cast<callable_t*>(storage), std::forward<args_t>(args)...);
+            }
+        },
+        [](void* destination, const void* source)
+        {
+            ::new(destination) callable_t(*static_cast<const callable_t*>(source));
+        },
+        [](void* destination, void* source) noexcept
+        {
+            ::new(destination) callable_t(std::move(*static_cast<callable_t*>(source)));
+            static_cast<callable_t*>(source)->~callable_t();
+        },
+        [](void* storage) noexcept
+        {
+            static_cast<callable_t*>(storage)->~callable_t();
+        }
+    };
+
+    /// Storage of the callable. Mutable: like std::function, operator() is const.
+    alignas(alignment) mutable std::byte _storage[capacity];
+
+    /// Operations on the stored callable. nullptr if empty.
+    const vtable* _vtable = nullptr;
+
+    template<typename callable_t>
+    static constexpr bool is_compatible = !std::is_same_v<std::decay_t<callable_t>, inplace_function> &&
+                                          std::is_invocable_r_v<result_t, std::decay_t<callable_t>&, args_t...>;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /// Constructs an empty function.
+    inline inplace_function() noexcept {}
+
+    /// Constructs an empty function.
+    inline inplace_function(std::nullptr_t) noexcept {}
+
+    /// Stores a copy of 'callable'. Like std::function, the function is empty if 'callable' is a null pointer.
+    template<typename callable_t, typename = std::enable_if_t<is_compatible<callable_t>>>
+    inline inplace_function(callable_t&& callable)
+    {
+        using stored_t = std::decay_t<callable_t>;
+
+        static_assert(sizeof(stored_t) <= capacity,
+                      "ste::inplace_function: callable too large, increase the capacity template parameter.");
+        static_assert(alignment % alignof(stored_t) == 0,
+                      "ste::inplace_function: callable over-aligned, increase the alignment template parameter.");
+        static_assert(std::is_copy_constructible_v<stored_t>,
+                      "ste::inplace_function: callable must be copy constructible.");
+        static_assert(std::is_nothrow_move_constructible_v<stored_t>,
+                      "ste::inplace_function: callable must be nothrow move constructible.");
+
+        if constexpr(std::is_pointer_v<stored_t> || std::is_member_pointer_v<stored_t>)
+        {
+            if(callable == nullptr)
+            {
+                return;
+            }
+        }
+
+        ::new(static_cast<void*>(_storage)) stored_t(std::forward<callable_t>(callable));
+        _vtable = &vtable_for<stored_t>;
+    }
+
+    inline inplace_function(const inplace_function& other)
+        : _vtable(other._vtable)
+    {
+        if(_vtable != nullptr)
+        {
+            _vtable->copy(_storage, other._storage);
+        }
+    }
+
+    inline inplace_function(inplace_function&& other) noexcept
+        : _vtable(other._vtable)
+    {
+        if(_vtable != nullptr)
+        {
+            _vtable->move(_storage, other._storage);
+            other._vtable = nullptr;
+        }
+    }
+
+    inline ~inplace_function()
+    {
+        reset();
+    }
+
+    inline inplace_function& operator=(const inplace_function& other)
+    {
+        if(this != &other)
+        {
+            reset();
+
+            if(other._vtable != nullptr)
+            {
+                other._vtable->copy(_storage, other._storage);
+                _vtable = other._vtable;
+            }
+        }
+
+        return *this;
+    }
+
+    inline inplace_function& operator=(inplace_function&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+
+            if(other._vtable != nullptr)
+            {
+                other._vtable->move(_storage, other._storage);
+                _vtable       = other._vtable;
+                other._vtable = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    inline inplace_function& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template<typename callable_t, typename = std::enable_if_t<is_compatible<callable_t>>>
+    inline inplace_function& operator=(callable_t&& callable)
+    {
+        return *this = inplace_function(std::forward<callable_t>(callable));
+    }
+
+    /*********************************************************************/
+    /*                            Operators                              */
+    /*********************************************************************/
+
+    /// Calls the stored callable. Throws std::bad_function_call if empty.
+    inline result_t operator()(args_t... args) const
+    {
+        if(_vtable == nullptr)
+        {
+            throw std::bad_function_call();
+        }
+
+        return _vtable->invoke(_storage, std::forward<args_t>(args)...);
+    }
+
+    /// Returns 'true' if a callable is stored.
+    inline explicit operator bool() const noexcept
+    {
+        return _vtable != nullptr;
+    }
+
+private:
+
+    inline void reset() noexcept
+    {
+        if(_vtable != nullptr)
+        {
+            _vtable->destroy(_storage);
+            _vtable = nullptr;
+        }
+    }
+};
+
+} //namespace ste
+#endif //STE_inplace_function_HPP
@@ -0,0 +1,163 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_manual_clock_HPP
+#define STE_manual_clock_HPP
+
+#include "timer_service.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <cstdint>
+
+#include <mutex>
+
+namespace ste
+{
+
+/**
+                                ste::manual_clock
+
+    @short Simulated clock that only moves when told to, for fast-forward tests and replays.
+
+    @details
+    Satisfies the standard Clock requirements (now(), is_steady), so that it can be given to
+    ste::timer and ste::basic_timer_service in place of std::chrono::steady_clock.
+
+    Every timer on a manual_clock is served by service(), a service without thread nor fd
+    (a ste::basic_timer_service<manual_clock> with threads throws std::invalid_argument):
+    advance() moves the time from one deadline to the next and runs the due callbacks on the
+    calling thread, in deadline order (scheduling order for equal deadlines). Hours of
+    simulated time take as long as the callbacks themselves, and a run is reproducible.
+    A continuous timer with a zero interval would never let the time move: start() throws
+    std::invalid_argument.
+
+        ste::timer<f_t, std::chrono::seconds, std::chrono::seconds, ste::manual_clock> t(f, 60, 0, false, true);
+        ste::manual_clock::advance(std::chrono::hours(24)); // f is called 1440 times, now.
+
+    The time is process-wide and starts at the epoch.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class manual_clock
+{
+public:
+
+    using rep        = std::int64_t;
+    using period     = std::nano;
+    using duration   = std::chrono::duration<rep, period>;
+    using time_point = std::chrono::time_point<manual_clock>;
+
+    static constexpr bool is_steady = true;
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    /// Current time, in nanoseconds since the epoch.
+    static inline std::atomic<rep> _now = 0;
+
+    /// Serializes advance() / advance_to().
+    static inline std::mutex _advance_mutex;
+
+public:
+
+    /*********************************************************************/
+    /*                                Time                               */
+    /*********************************************************************/
+
+    /// Returns the current simulated time.
+    static inline time_point now() noexcept
+    {
+        return time_point(duration(_now.load(std::memory_order_acquire)));
+    }
+
+    /**
+     *  @brief Moves the time forward by 'd', running every callback that falls due on the way.
+     *  @note  Must not be called from a callback.
+     */
+    static inline void advance(const duration d)
+    {
+        std::lock_guard lock(_advance_mutex);
+        move_to(now() + d);
+    }
+
+    /**
+     *  @brief Moves the time forward to 't', running every callback that falls due on the way.
+     *         Nothing happens if 't' is in the past.
+     *  @note  Must not be called from a callback.
+     */
+    static inline void advance_to(const time_point t)
+    {
+        std::lock_guard lock(_advance_mutex);
+        move_to(t);
+    }
+
+    /// Service of the timers on this clock. Has no thread: driven by advance().
+    static inline basic_timer_service<manual_clock>& service()
+    {
+        static basic_timer_service<manual_clock> instance(0);
+        return instance;
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// Steps through the deadlines up to 't'. Callbacks see now() equal to the deadline that woke
+    /// them: slack only lets an expiration share the wakeup of an earlier one.
+    static inline void move_to(const time_point t)
+    {
+        auto& s = service();
+
+        for(auto next = s.next_due(); next <= t; next = s.next_due())
+        {
+            if(next > now())
+            {
+                _now.store(next.time_since_epoch().count(), std::memory_order_release);
+            }
+
+            s.dispatch_ready();
+        }
+
+        if(t > now())
+        {
+            _now.store(t.time_since_epoch().count(), std::memory_order_release);
+        }
+    }
+};
+
+} //namespace ste
+#endif //STE_manual_clock_HPP
@@ -0,0 +1,332 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_rcu_cell_HPP
+#define STE_rcu_cell_HPP
+
+#include <array>
+
+#include <atomic>
+
+#include <cstdint>
+
+#include <functional>
+
+#include <mutex>
+
+#include <optional>
+
+#include <thread>
+
+namespace ste
+{
+
+/**
+                                ste::rcu_cell
+
+    @short Holds a value that can be replaced while other threads are reading it.
+
+    @details
+    Features:
+        • Wait-free read side: a reader never blocks on a writer, and always sees a
+          complete value (the old one or the new one).
+        • Allocation-free write side: the value lives in one of three in-place slots.
+          A writer reuses a slot only once every reader that could still see it has left.
+        • Writers are serialised by a mutex and may wait for slow readers to leave.
+
+    Readers register in one of two counters, selected by an epoch that writers flip
+    to let the other counter drain. A retired slot is reused once both counters have
+    been observed at zero after it was retired.
+
+    A reader may replace the value from inside read(). Its own read keeps the retired slots
+    alive until it returns, so when no slot is free, the value is kept aside and stored when
+    the outermost read of that thread returns, instead of waiting for itself forever. Only
+    the last of several such values is stored, and a store() from another thread in the
+    meantime supersedes it.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename value_t>
+class rcu_cell
+{
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    static constexpr std::size_t slot_count = 3;
+
+    /// Writer-side bookkeeping of a slot. Protected by _write_mutex.
+    struct retirement
+    {
+        bool pending = false;                       ///< Replaced, may still be read.
+        std::array<bool, 2> drained = {false, false};  ///< Counter observed at zero since retirement.
+    };
+
+    /// Storage. Only the slot designated by _current may be used by new readers.
+    std::array<std::optional<value_t>, slot_count> _values;
+
+    /// Slot of the current value.
+    std::atomic<std::uint8_t> _current = 0;
+
+    /// Selects the reader counter used by new readers.
+    mutable std::atomic<std::uint8_t> _epoch = 0;
+
+    /// Number of readers registered under each epoch.
+    mutable std::array<std::atomic<std::uint32_t>, 2> _readers = {};
+
+    /// Serialises writers.
+    std::mutex _write_mutex;
+
+    std::array<retirement, slot_count> _retired;
+
+    /// Value stored from inside a read while no slot was free. Protected by _write_mutex.
+    std::optional<value_t> _deferred;
+
+    /// Thread that must store _deferred when its reads return. No thread if there is none.
+    std::atomic<std::thread::id> _deferred_by;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /// Constructor.
+    inline explicit rcu_cell(value_t value)
+    {
+        _values[0].emplace(std::move(value));
+    }
+
+    rcu_cell(const rcu_cell&)            = delete;
+    rcu_cell(rcu_cell&&)                 = delete;
+    rcu_cell& operator=(const rcu_cell&) = delete;
+    rcu_cell& operator=(rcu_cell&&)      = delete;
+
+    /*********************************************************************/
+    /*                            Read side                              */
+    /*********************************************************************/
+
+    /// Calls 'f' with the current value. Wait-free.
+    template<typename read_f>
+    inline decltype(auto) read(read_f&& f)
+    {
+        const reader guard(*this);
+        return std::invoke(std::forward<read_f>(f), *_values[guard.slot]);
+    }
+
+    /// Calls 'f' with the current value. Wait-free.
+    template<typename read_f>
+    inline decltype(auto) read(read_f&& f) const
+    {
+        const reader guard(*this);
+        return std::invoke(std::forward<read_f>(f), *_values[guard.slot]);
+    }
+
+    /// Returns a copy of the current value.
+    inline value_t load() const
+    {
+        return read([](const value_t& value) { return value; });
+    }
+
+    /*********************************************************************/
+    /*                            Write side                             */
+    /*********************************************************************/
+
+    /**
+     *  @brief Replaces the value. Readers that are still using the previous value are not affected.
+     *  @note  From inside read(), never waits: if the caller's own read pins every slot, the value
+     *         is stored when the outermost read of the calling thread returns.
+     */
+    inline void store(value_t value)
+    {
+        std::lock_guard lock(_write_mutex);
+
+        if(reading())
+        {
+            if(const auto next = try_free_slot(_current.load()))
+            {
+                _deferred.reset();
+                _deferred_by.store(std::thread::id());
+
+                replace(*next, std::move(value));
+            }
+            else
+            {
+                _deferred.emplace(std::move(value));
+                _deferred_by.store(std::this_thread::get_id());
+            }
+
+            return;
+        }
+
+        // Stored after the deferred value: replaces it.
+        _deferred.reset();
+        _deferred_by.store(std::thread::id());
+
+        replace(await_free_slot(_current.load()), std::move(value));
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// Registers a reader for its lifetime and pins the current slot.
+    struct reader
+    {
+        /// Innermost read of the calling thread, on any cell. Reads of a thread form a stack.
+        static inline thread_local const reader* innermost = nullptr;
+
+        const rcu_cell& cell;
+        std::atomic<std::uint32_t>& counter;
+        const reader* const outer;
+        std::uint8_t slot;
+
+        inline explicit reader(const rcu_cell& c)
+            :
+              cell(c),
+              counter(c._readers[c._epoch.load()]),
+              outer(innermost)
+        {
+            counter.fetch_add(1);
+            slot      = cell._current.load();
+            innermost = this;
+        }
+
+        inline ~reader()
+        {
+            counter.fetch_sub(1, std::memory_order_release);
+            innermost = outer;
+
+            // The value stored from inside the read, once no read of this thread pins a slot anymore.
+            if(cell._deferred_by.load(std::memory_order_relaxed) == std::this_thread::get_id() && !cell.reading())
+            {
+                // Only a non-const cell can have been stored to.
+                const_cast<rcu_cell&>(cell).store_deferred();
+            }
+        }
+
+        reader(const reader&)            = delete;
+        reader& operator=(const reader&) = delete;
+    };
+
+    /// Returns 'true' if the calling thread is inside read().
+    inline bool reading() const
+    {
+        for(const reader* r = reader::innermost; r != nullptr; r = r->outer)
+        {
+            if(&r->cell == this)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Makes 'value' current in slot 'next', and retires the previous slot. Requires _write_mutex.
+    inline void replace(const std::uint8_t next, value_t value)
+    {
+        const std::uint8_t previous = _current.load();
+
+        _values[next].emplace(std::move(value));
+        _current.store(next);
+
+        _retired[previous] = {true, {false, false}};
+
+        _epoch.store(static_cast<std::uint8_t>(1 - _epoch.load()));
+    }
+
+    /// Stores the value deferred by the calling thread, if another store did not replace it.
+    inline void store_deferred()
+    {
+        std::lock_guard lock(_write_mutex);
+
+        if(_deferred_by.load() != std::this_thread::get_id())
+        {
+            return;
+        }
+
+        value_t value = std::move(*_deferred);
+        _deferred.reset();
+        _deferred_by.store(std::thread::id());
+
+        replace(await_free_slot(_current.load()), std::move(value));
+    }
+
+    /// Returns a slot that no reader can see, if there is one. Requires _write_mutex.
+    inline std::optional<std::uint8_t> try_free_slot(const std::uint8_t current)
+    {
+        for(std::uint8_t i = 0; i < slot_count; ++i)
+        {
+            if(i == current)
+            {
+                continue;
+            }
+
+            retirement& r = _retired[i];
+
+            for(std::size_t c = 0; c < r.drained.size(); ++c)
+            {
+                r.drained[c] = r.drained[c] || _readers[c].load() == 0;
+            }
+
+            if(!r.pending || (r.drained[0] && r.drained[1]))
+            {
+                r.pending = false;
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    /// Returns a slot that no reader can see, waiting for readers to leave if needed. Requires _write_mutex.
+    /// The calling thread must not be inside read().
+    inline std::uint8_t await_free_slot(const std::uint8_t current)
+    {
+        for(;;)
+        {
+            if(const auto slot = try_free_slot(current))
+            {
+                return *slot;
+            }
+
+            // Sends new readers to the other counter so that both eventually drain.
+            _epoch.store(static_cast<std::uint8_t>(1 - _epoch.load()));
+            std::this_thread::yield();
+        }
+    }
+};
+
+} //namespace ste
+#endif //STE_rcu_cell_HPP
@@ -0,0 +1,358 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_sharded_timer_service_HPP
+#define STE_sharded_timer_service_HPP
+
+#include "timer_service.hpp"
+
+#include <algorithm>
+
+#include <atomic>
+
+#include <cstdint>
+
+#include <memory>
+
+#include <thread>
+
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+
+#include <unistd.h>
+#endif
+
+namespace ste
+{
+
+/**
+                                ste::sharded_timer_service
+
+    @short Several ste::timer_service shards, one per CPU, each with its own dispatcher thread.
+
+    @details
+    Features:
+        • Scheduling goes to the shard of the CPU the calling thread runs on, so that threads
+          on different CPUs do not contend on the same lock nor on the same cache lines.
+        • At most one shard per CPU the process may run on, so that every shard is someone's
+          local shard.
+        • On Linux, the dispatcher of shard i is pinned to the i-th CPU the process may run on,
+          and the local shard is found with sched_getcpu(). A pin that cannot be applied is
+          reported by thread_status() (see shard(i).thread_status() for a given shard).
+          Elsewhere, each thread is given a shard once per service, round-robin.
+        • Handles carry their shard: cancel() and reschedule() work from any thread, on any shard.
+        • Shards are plain ste::timer_service objects: a ste::timer can be registered with
+          local_shard() or shard(i).
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class sharded_timer_service
+{
+public:
+
+    using clock      = timer_service::clock;
+    using duration   = timer_service::duration;
+    using time_point = timer_service::time_point;
+    using callback_t = timer_service::callback_t;
+
+    /// Identifies a scheduled expiration and its shard.
+    struct id
+    {
+        timer_service::id value = 0;
+        std::uint32_t shard     = 0;
+
+        inline explicit operator bool() const noexcept { return value != 0; }
+    };
+
+    /// Identifies a timeout and its shard.
+    struct timeout_handle
+    {
+        timer_service::timeout_handle value = {};
+        std::uint32_t shard                 = 0;
+
+        inline explicit operator bool() const noexcept { return static_cast<bool>(value); }
+    };
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    std::vector<std::unique_ptr<timer_service>> _shards;
+
+    /// Shard of each CPU number.
+    std::vector<std::uint32_t> _cpu_to_shard;
+
+    /// Number of services created. Offsets the shards given to threads when the CPU cannot be queried.
+    static inline std::atomic<std::uint32_t> _instances = 0;
+
+    /// Shard given to thread 0 when the CPU cannot be queried.
+    const std::uint32_t _instance = _instances.fetch_add(1, std::memory_order_relaxed);
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param shards (optional) Number of shards, capped at the number of CPUs available to the
+     *                           process. Default is 0, for one per CPU.
+     *  @param pin (optional) Pins the dispatcher of each shard to its CPU. Default is true.
+     *                        Pins that cannot be applied are reported by thread_status().
+     *  @param attributes (optional) Attributes of the dispatcher threads (see ste::thread_attributes).
+     *                               Their CPUs are replaced by the shard's own CPU when 'pin' is true.
+     */
+    inline explicit sharded_timer_service(const std::size_t shards = 0, const bool pin = true, const thread_attributes& attributes = {})
+    {
+        const std::vector<int> cpus = available_cpus();
+
+        // More shards than CPUs: the extra shards would never be local to any thread.
+        const std::size_t count = shards != 0 ? std::min(shards, cpus.size()) : cpus.size();
+
+        _shards.reserve(count);
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            thread_attributes shard_attributes = attributes;
+
+            if(pin)
+            {
+                shard_attributes.cpus = {cpus[i]};
+            }
+
+            _shards.push_back(std::make_unique<timer_service>(1, shard_attributes));
+        }
+
+        // CPUs share shards round-robin when there are fewer shards than CPUs.
+        const int max_cpu = cpus.empty() ? 0 : *std::max_element(cpus.begin(), cpus.end());
+        _cpu_to_shard.assign(static_cast<std::size_t>(max_cpu) + 1, 0);
+
+        for(std::size_t i = 0; i < cpus.size(); ++i)
+        {
+            _cpu_to_shard[static_cast<std::size_t>(cpus[i])] = static_cast<std::uint32_t>(i % count);
+        }
+    }
+
+    sharded_timer_service(const sharded_timer_service&)            = delete;
+    sharded_timer_service(sharded_timer_service&&)                 = delete;
+    sharded_timer_service& operator=(const sharded_timer_service&) = delete;
+    sharded_timer_service& operator=(sharded_timer_service&&)      = delete;
+
+    /*********************************************************************/
+    /*                             Scheduling                            */
+    /*********************************************************************/
+
+    /// Calls 'callback' once at 'deadline', or up to 'slack' later, from the local shard.
+    inline id schedule_at(const time_point deadline, callback_t callback, const duration slack = duration::zero())
+    {
+        const auto s = local_index();
+        return {_shards[s]->schedule_at(deadline, std::move(callback), slack), s};
+    }
+
+    /// Calls 'callback' once after 'delay', or up to 'slack' later, from the local shard.
+    inline id schedule_after(const duration delay, callback_t callback, const duration slack = duration::zero())
+    {
+        const auto s = local_index();
+        return {_shards[s]->schedule_after(delay, std::move(callback), slack), s};
+    }
+
+    /// Calls 'callback' after 'delay', then every 'period' until cancelled, from the local shard.
+    inline id schedule_every(const duration delay, const duration period, callback_t callback, const duration slack = duration::zero())
+    {
+        const auto s = local_index();
+        return {_shards[s]->schedule_every(delay, period, std::move(callback), slack), s};
+    }
+
+    /// Calls 'callback' once after 'delay' unless cancelled first, from the local shard (see ste::timer_service::schedule_timeout()).
+    inline timeout_handle schedule_timeout(const duration delay, callback_t callback)
+    {
+        const auto s = local_index();
+        return {_shards[s]->schedule_timeout(delay, std::move(callback)), s};
+    }
+
+    /// Cancels an expiration, whatever its shard (see ste::timer_service::cancel()).
+    inline bool cancel(const id i)
+    {
+        return i.shard < _shards.size() && _shards[i.shard]->cancel(i.value);
+    }
+
+    /// Cancels a timeout, whatever its shard. Never waits.
+    inline bool cancel(const timeout_handle t)
+    {
+        return t.shard < _shards.size() && _shards[t.shard]->cancel(t.value);
+    }
+
+    /// Moves the next expiration of 'i' to 'deadline' (see ste::timer_service::reschedule()).
+    inline bool reschedule(const id i, const time_point deadline)
+    {
+        return i.shard < _shards.size() && _shards[i.shard]->reschedule(i.value, deadline);
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Returns 'true' if 'i' is scheduled or running.
+    inline bool pending(const id i) const
+    {
+        return i.shard < _shards.size() && _shards[i.shard]->pending(i.value);
+    }
+
+    /// Returns 'true' if 't' has neither fired nor been cancelled.
+    inline bool pending(const timeout_handle t) const
+    {
+        return t.shard < _shards.size() && _shards[t.shard]->pending(t.value);
+    }
+
+    /// Returns the shard of the CPU the calling thread runs on.
+    inline timer_service& local_shard()
+    {
+        return *_shards[local_index()];
+    }
+
+    /// Returns shard 'i'.
+    inline timer_service& shard(const std::size_t i)
+    {
+        return *_shards[i];
+    }
+
+    /// Returns the number of shards.
+    inline std::size_t shard_count() const
+    {
+        return _shards.size();
+    }
+
+    /// Returns the number of scheduled or running expirations and pending timeouts, all shards included.
+    inline std::size_t size() const
+    {
+        std::size_t total = 0;
+
+        for(const auto& s : _shards)
+        {
+            total += s->size();
+        }
+
+        return total;
+    }
+
+    /// Returns the number of wakeups saved by slack, all shards included.
+    inline std::uint64_t coalesced_wakeups() const
+    {
+        std::uint64_t total = 0;
+
+        for(const auto& s : _shards)
+        {
+            total += s->coalesced_wakeups();
+        }
+
+        return total;
+    }
+
+    /// Returns what could not be applied to the dispatcher threads, all shards included.
+    inline thread_attributes_status thread_status() const
+    {
+        thread_attributes_status status;
+
+        for(const auto& s : _shards)
+        {
+            status |= s->thread_status();
+        }
+
+        return status;
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// Returns the index of the local shard.
+    inline std::uint32_t local_index()
+    {
+#if defined(__linux__)
+        // Served from the vDSO / rseq: a few nanoseconds, and follows thread migrations.
+        const int cpu = ::sched_getcpu();
+
+        if(cpu >= 0 && static_cast<std::size_t>(cpu) < _cpu_to_shard.size())
+        {
+            return _cpu_to_shard[static_cast<std::size_t>(cpu)];
+        }
+#endif
+
+        // One shard per thread and per service, for the lifetime of the thread: threads are
+        // numbered once, and each service offsets the numbers by its own.
+        static std::atomic<std::uint32_t> threads = 0;
+        thread_local const std::uint32_t thread_number = threads.fetch_add(1, std::memory_order_relaxed);
+
+        return (thread_number + _instance) % static_cast<std::uint32_t>(_shards.size());
+    }
+
+    /// Returns the CPUs the process may run on: those of its main thread, whichever thread asks.
+    static inline std::vector<int> available_cpus()
+    {
+        std::vector<int> cpus;
+
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        // The thread whose id is the process id is the main thread: a caller restricted to fewer
+        // CPUs than the process does not restrict the shards.
+        if(::sched_getaffinity(::getpid(), sizeof(set), &set) == 0)
+        {
+            for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if(CPU_ISSET(cpu, &set))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+
+        if(cpus.empty())
+        {
+            for(unsigned cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+            {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+        }
+
+        return cpus;
+    }
+};
+
+} //namespace ste
+#endif //STE_sharded_timer_service_HPP
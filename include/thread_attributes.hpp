@@ -0,0 +1,570 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_thread_attributes_HPP
+#define STE_thread_attributes_HPP
+
+#include <cerrno>
+
+#include <cstddef>
+
+#include <cstring>
+
+#include <exception>
+
+#include <future>
+
+#include <memory>
+
+#include <ostream>
+
+#include <string>
+
+#include <system_error>
+
+#include <thread>
+
+#include <type_traits>
+
+#include <utility>
+
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+
+#include <sched.h>
+
+#include <sys/mman.h>
+#endif
+
+namespace ste
+{
+
+/// Scheduling policy of a thread.
+enum class sched_policy
+{
+    other,          ///< Default time-sharing policy (SCHED_OTHER).
+    fifo,           ///< Real-time, first in first out (SCHED_FIFO). Usually requires privileges.
+    round_robin     ///< Real-time, round robin (SCHED_RR). Usually requires privileges.
+};
+
+/**
+                                ste::thread_attributes
+
+    @short Settings of the threads created by ste::timer, ste::fixed_timer and ste::timer_service.
+
+    @details
+    Every field left to its default keeps the corresponding setting of a plain std::thread.
+    Settings that cannot be applied (lack of privileges, invalid values, unsupported platform)
+    are skipped: the thread still runs, and the error is reported in a ste::thread_attributes_status.
+
+    ste::attributed_thread sets the policy, priority, CPUs and stack size on the pthread_attr_t
+    the thread is created with, and the thread sets its own name before anything else: it never
+    runs a single instruction of its function with the default settings.
+
+    lock_memory is not a thread setting: mlockall() locks every page of the whole process,
+    current and future, whichever thread asks for it.
+
+    Only supported on Linux. Elsewhere, every requested setting is reported as ENOTSUP.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+struct thread_attributes
+{
+    sched_policy policy = sched_policy::other;  ///< Scheduling policy.
+    int priority        = 0;                    ///< Real-time priority (1-99 on Linux). Must be 0 with sched_policy::other.
+    std::vector<int> cpus;                      ///< CPUs the thread may run on. Empty: any.
+    std::size_t stack_size = 0;                 ///< Stack size in bytes. 0: default (usually 8 MB).
+    std::string name;                           ///< Name shown by top, ps, perf and debuggers. Truncated to 15 characters.
+    bool lock_memory = false;                   ///< Locks the pages of the whole process, every thread included, in RAM (mlockall), so that no call page-faults.
+};
+
+/// Outcome of applying ste::thread_attributes: for each setting, 0 if applied or not requested, the errno value otherwise.
+struct thread_attributes_status
+{
+    int scheduling  = 0;    ///< Policy and priority.
+    int affinity    = 0;    ///< CPUs.
+    int stack_size  = 0;    ///< Stack size.
+    int name        = 0;    ///< Name.
+    int lock_memory = 0;    ///< mlockall.
+
+    /// Returns 'true' if every requested setting was applied.
+    inline bool ok() const
+    {
+        return scheduling == 0 && affinity == 0 && stack_size == 0 && name == 0 && lock_memory == 0;
+    }
+
+    /// Keeps the first error of each setting of 'this' and 'other'.
+    inline thread_attributes_status& operator|=(const thread_attributes_status& other)
+    {
+        scheduling  = scheduling  != 0 ? scheduling  : other.scheduling;
+        affinity    = affinity    != 0 ? affinity    : other.affinity;
+        stack_size  = stack_size  != 0 ? stack_size  : other.stack_size;
+        name        = name        != 0 ? name        : other.name;
+        lock_memory = lock_memory != 0 ? lock_memory : other.lock_memory;
+
+        return *this;
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& out, const thread_attributes_status& s)
+    {
+        if(s.ok())
+        {
+            return out << "ste::thread_attributes: all applied";
+        }
+
+        out << "ste::thread_attributes: not applied:";
+
+        const std::pair<const char*, int> settings[] = {{"scheduling", s.scheduling}, {"affinity", s.affinity}, {"stack size", s.stack_size},
+                                                        {"name", s.name}, {"lock memory", s.lock_memory}};
+
+        for(const auto& [setting, error] : settings)
+        {
+            if(error != 0)
+            {
+                out << "\n    " << setting << ": " << std::strerror(error);
+            }
+        }
+
+        return out;
+    }
+};
+
+#if defined(__linux__)
+/**
+ *  @brief  Applies the scheduling, affinity, name and memory locking of 'attributes' to 'thread'.
+ *          The stack size can only be set at creation (see ste::attributed_thread).
+ *  @return What could not be applied. Settings that failed are left unchanged.
+ */
+inline thread_attributes_status apply_thread_attributes(const pthread_t thread, const thread_attributes& attributes)
+{
+    thread_attributes_status status;
+
+    if(attributes.policy != sched_policy::other || attributes.priority != 0)
+    {
+        const int policy = attributes.policy == sched_policy::fifo        ? SCHED_FIFO :
+                           attributes.policy == sched_policy::round_robin ? SCHED_RR   :
+                                                                            SCHED_OTHER;
+
+        sched_param parameters = {};
+        parameters.sched_priority = attributes.priority;
+
+        status.scheduling = ::pthread_setschedparam(thread, policy, &parameters);
+    }
+
+    if(!attributes.cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        for(const int cpu : attributes.cpus)
+        {
+            if(cpu < 0 || cpu >= CPU_SETSIZE)
+            {
+                status.affinity = EINVAL;
+                break;
+            }
+
+            CPU_SET(cpu, &set);
+        }
+
+        if(status.affinity == 0)
+        {
+            status.affinity = ::pthread_setaffinity_np(thread, sizeof(set), &set);
+        }
+    }
+
+    if(!attributes.name.empty())
+    {
+        status.name = ::pthread_setname_np(thread, attributes.name.substr(0, 15).c_str());
+    }
+
+    if(attributes.lock_memory && ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        status.lock_memory = errno;
+    }
+
+    return status;
+}
+#endif
+
+/**
+ *  @brief  Applies 'attributes' to the calling thread, except the stack size.
+ *  @return What could not be applied.
+ */
+inline thread_attributes_status apply_thread_attributes(const thread_attributes& attributes)
+{
+#if defined(__linux__)
+    thread_attributes_status status = apply_thread_attributes(::pthread_self(), attributes);
+    status.stack_size = attributes.stack_size != 0 ? EBUSY : 0;
+    return status;
+#else
+    thread_attributes_status status;
+    status.scheduling  = (attributes.policy != sched_policy::other || attributes.priority != 0) ? ENOTSUP : 0;
+    status.affinity    = attributes.cpus.empty()   ? 0 : ENOTSUP;
+    status.stack_size  = attributes.stack_size == 0 ? 0 : ENOTSUP;
+    status.name        = attributes.name.empty()   ? 0 : ENOTSUP;
+    status.lock_memory = attributes.lock_memory    ? ENOTSUP : 0;
+    return status;
+#endif
+}
+
+/**
+                                ste::attributed_thread
+
+    @short std::thread-like thread created with ste::thread_attributes.
+
+    @details
+    On Linux, the thread is created with pthread_create() and a pthread_attr_t carrying the
+    scheduling policy and priority (PTHREAD_EXPLICIT_SCHED), the CPUs and the stack size, so that
+    it starts with them. A thread given a name sets it before calling its function, and the
+    constructor waits for that; without a name, the constructor returns once the thread is created.
+    A setting that makes pthread_create() fail (EPERM for a real-time policy without
+    privileges, EINVAL for CPUs that do not exist) is dropped and the thread is created again
+    without it. status() reports what could not be applied.
+    Elsewhere, it is a std::thread and the attributes are not applied.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class attributed_thread
+{
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+#if defined(__linux__)
+    pthread_t _handle = {};
+    bool _joinable    = false;
+#else
+    std::thread _thread;
+#endif
+
+    /// What could not be applied when the thread was created.
+    thread_attributes_status _status;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /// Constructs an object that does not represent a thread.
+    inline attributed_thread() noexcept = default;
+
+    /**
+     *  @brief Starts a thread with 'attributes' that calls 'function'.
+     *  @throw std::system_error if the thread cannot be created.
+     */
+    template<typename function_t>
+    inline attributed_thread(const thread_attributes& attributes, function_t&& function)
+    {
+#if defined(__linux__)
+        using callable_t = std::decay_t<function_t>;
+
+        // Only a named thread needs its start data, and a handshake to report the name.
+        std::unique_ptr<callable_t> plain;
+        std::unique_ptr<start_data<callable_t>> start;
+        std::future<int> named;
+
+        if(attributes.name.empty())
+        {
+            plain = std::make_unique<callable_t>(std::forward<function_t>(function));
+        }
+        else
+        {
+            start = std::make_unique<start_data<callable_t>>(std::forward<function_t>(function), attributes.name);
+            named = start->named.get_future();
+        }
+
+        if(attributes.lock_memory && ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            _status.lock_memory = errno;
+        }
+
+        bool scheduling = attributes.policy != sched_policy::other || attributes.priority != 0;
+        bool affinity   = !attributes.cpus.empty();
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+
+        for(const int cpu : attributes.cpus)
+        {
+            if(cpu < 0 || cpu >= CPU_SETSIZE)
+            {
+                _status.affinity = EINVAL;
+                affinity         = false;
+                break;
+            }
+
+            CPU_SET(cpu, &cpus);
+        }
+
+        int error = 0;
+
+        // Each failure attributable to a setting drops it, then creates the thread again.
+        for(;;)
+        {
+            pthread_attr_t creation;
+            ::pthread_attr_init(&creation);
+
+            if(attributes.stack_size != 0)
+            {
+                // Below PTHREAD_STACK_MIN: EINVAL, the default size is kept.
+                _status.stack_size = ::pthread_attr_setstacksize(&creation, attributes.stack_size);
+            }
+
+            if(scheduling)
+            {
+                const int policy = attributes.policy == sched_policy::fifo        ? SCHED_FIFO :
+                                   attributes.policy == sched_policy::round_robin ? SCHED_RR   :
+                                                                                    SCHED_OTHER;
+
+                sched_param parameters = {};
+                parameters.sched_priority = attributes.priority;
+
+                int e = ::pthread_attr_setinheritsched(&creation, PTHREAD_EXPLICIT_SCHED);
+                e     = e != 0 ? e : ::pthread_attr_setschedpolicy(&creation, policy);
+                e     = e != 0 ? e : ::pthread_attr_setschedparam(&creation, &parameters);
+
+                if(e != 0)
+                {
+                    ::pthread_attr_destroy(&creation);
+                    _status.scheduling = e;
+                    scheduling         = false;
+                    continue;
+                }
+            }
+
+            if(affinity)
+            {
+                const int e = ::pthread_attr_setaffinity_np(&creation, sizeof(cpus), &cpus);
+
+                if(e != 0)
+                {
+                    ::pthread_attr_destroy(&creation);
+                    _status.affinity = e;
+                    affinity         = false;
+                    continue;
+                }
+            }
+
+            error = plain ? ::pthread_create(&_handle, &creation, &entry<callable_t>, plain.get())
+                          : ::pthread_create(&_handle, &creation, &named_entry<callable_t>, start.get());
+            ::pthread_attr_destroy(&creation);
+
+            if(error == EPERM && scheduling)
+            {
+                _status.scheduling = error;
+                scheduling         = false;
+            }
+            else if(error == EINVAL && affinity)
+            {
+                _status.affinity = error;
+                affinity         = false;
+            }
+            else if(error == EINVAL && scheduling)
+            {
+                _status.scheduling = error;
+                scheduling         = false;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if(error != 0)
+        {
+            throw std::system_error(error, std::generic_category(), "ste::attributed_thread: pthread_create");
+        }
+
+        // Owned by the thread.
+        plain.release();
+        start.release();
+        _joinable = true;
+
+        if(named.valid())
+        {
+            _status.name = named.get();
+        }
+#else
+        _thread = std::thread(std::forward<function_t>(function));
+        _status = apply_thread_attributes(attributes);
+#endif
+    }
+
+    /// Destructor. Like std::thread, terminates the program if the thread is still joinable.
+    inline ~attributed_thread()
+    {
+        if(joinable())
+        {
+            std::terminate();
+        }
+    }
+
+    attributed_thread(const attributed_thread&)            = delete;
+    attributed_thread& operator=(const attributed_thread&) = delete;
+
+    inline attributed_thread(attributed_thread&& other) noexcept
+    {
+        swap(other);
+    }
+
+    inline attributed_thread& operator=(attributed_thread&& other) noexcept
+    {
+        if(joinable())
+        {
+            std::terminate();
+        }
+
+        swap(other);
+        return *this;
+    }
+
+    /*********************************************************************/
+    /*                         Thread management                         */
+    /*********************************************************************/
+
+    /// Returns 'true' if the object represents a thread that was not joined.
+    inline bool joinable() const noexcept
+    {
+#if defined(__linux__)
+        return _joinable;
+#else
+        return _thread.joinable();
+#endif
+    }
+
+    /// Waits for the thread to return.
+    inline void join()
+    {
+#if defined(__linux__)
+        const int error = ::pthread_join(_handle, nullptr);
+
+        if(error != 0)
+        {
+            throw std::system_error(error, std::generic_category(), "ste::attributed_thread: pthread_join");
+        }
+
+        _joinable = false;
+#else
+        _thread.join();
+#endif
+    }
+
+    /// Returns 'true' if called from the thread this object represents.
+    inline bool is_current() const noexcept
+    {
+#if defined(__linux__)
+        return _joinable && ::pthread_equal(_handle, ::pthread_self()) != 0;
+#else
+        return _thread.get_id() == std::this_thread::get_id();
+#endif
+    }
+
+#if defined(__linux__)
+    /// Returns the pthread handle of the thread.
+    inline pthread_t native_handle() const noexcept
+    {
+        return _handle;
+    }
+#endif
+
+    /// Returns what could not be applied when the thread was created.
+    inline thread_attributes_status status() const noexcept
+    {
+        return _status;
+    }
+
+    inline void swap(attributed_thread& other) noexcept
+    {
+#if defined(__linux__)
+        std::swap(_handle, other._handle);
+        std::swap(_joinable, other._joinable);
+#else
+        std::swap(_thread, other._thread);
+#endif
+        std::swap(_status, other._status);
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+#if defined(__linux__)
+    /// What a named thread needs to start. Owned by the thread once it is created.
+    template<typename callable_t>
+    struct start_data
+    {
+        callable_t callable;
+        std::string name;
+        std::promise<int> named;    ///< Outcome of naming the thread.
+
+        template<typename function_t>
+        inline start_data(function_t&& function, std::string thread_name)
+            :
+              callable(std::forward<function_t>(function)),
+              name(std::move(thread_name))
+        {}
+    };
+
+    /// Start routine of a thread without a name. Calls its function.
+    /// Like std::thread, terminates the program if the function throws.
+    template<typename callable_t>
+    static inline void* entry(void* data) noexcept
+    {
+        const std::unique_ptr<callable_t> owned(static_cast<callable_t*>(data));
+
+        (*owned)();
+
+        return nullptr;
+    }
+
+    /// Start routine of a named thread. Names the thread, then calls its function.
+    /// Like std::thread, terminates the program if the function throws.
+    template<typename callable_t>
+    static inline void* named_entry(void* data) noexcept
+    {
+        const std::unique_ptr<start_data<callable_t>> owned(static_cast<start_data<callable_t>*>(data));
+
+        owned->named.set_value(::pthread_setname_np(::pthread_self(), owned->name.substr(0, 15).c_str()));
+        owned->callable();
+
+        return nullptr;
+    }
+#endif
+};
+
+} //namespace ste
+#endif //STE_thread_attributes_HPP
@@ -0,0 +1,304 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_thread_pool_HPP
+#define STE_thread_pool_HPP
+
+#include "inplace_function.hpp"
+
+#include <algorithm>
+
+#include <atomic>
+
+#include <condition_variable>
+
+#include <cstddef>
+
+#include <memory>
+
+#include <mutex>
+
+#include <thread>
+
+#include <vector>
+
+namespace ste
+{
+
+/**
+                                ste::thread_pool
+
+    @short Work-stealing thread pool. Satisfies the executor requirements of ste::executor_ref.
+
+    @details
+    Features:
+        • One task queue per worker. Tasks submitted from outside the pool are spread
+          round-robin over the queues, tasks submitted from a worker go to its own queue.
+        • Idle workers steal from the other queues before going to sleep.
+        • Tasks are ste::inplace_function objects stored in ring buffers that only
+          grow: once warmed up, execute() does not allocate.
+        • The destructor runs the remaining tasks, then joins the workers.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class thread_pool
+{
+public:
+
+    using task_t = inplace_function<void(void)>;
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    /// Task queue of one worker. Its owner pops the oldest task, thieves too.
+    struct alignas(64) queue
+    {
+        std::mutex mutex;
+        std::vector<task_t> ring = std::vector<task_t>(16);
+        std::size_t head = 0;
+        std::size_t size = 0;
+
+        /// Requires mutex.
+        inline void push(task_t&& task)
+        {
+            if(size == ring.size())
+            {
+                std::vector<task_t> larger(ring.size() * 2);
+
+                for(std::size_t i = 0; i < size; ++i)
+                {
+                    larger[i] = std::move(ring[(head + i) % ring.size()]);
+                }
+
+                ring = std::move(larger);
+                head = 0;
+            }
+
+            ring[(head + size) % ring.size()] = std::move(task);
+            ++size;
+        }
+
+        /// Requires mutex.
+        inline bool pop(task_t& task)
+        {
+            if(size == 0)
+            {
+                return false;
+            }
+
+            task = std::move(ring[head]);
+            ring[head] = nullptr;
+            head = (head + 1) % ring.size();
+            --size;
+
+            return true;
+        }
+    };
+
+    /// One queue per worker.
+    std::vector<std::unique_ptr<queue>> _queues;
+
+    /// Number of queued tasks, all queues included.
+    std::atomic<std::size_t> _pending = 0;
+
+    /// Number of workers waiting on _sleep_cv.
+    std::atomic<std::size_t> _sleepers = 0;
+
+    /// Next queue for tasks submitted from outside the pool.
+    std::atomic<std::size_t> _next = 0;
+
+    std::mutex _sleep_mutex;
+    std::condition_variable _sleep_cv;
+
+    /// Set by the destructor. Protected by _sleep_mutex.
+    bool _exiting = false;
+
+    std::vector<std::thread> _threads;
+
+    /// Pool and queue index of the calling thread, if it is a worker.
+    static inline thread_local const thread_pool* _current_pool = nullptr;
+    static inline thread_local std::size_t _current_index = 0;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param threads (optional) Number of workers. Default is the number of hardware threads.
+     */
+    inline explicit thread_pool(const std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u))
+    {
+        const std::size_t count = std::max<std::size_t>(threads, 1);
+
+        _queues.reserve(count);
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            _queues.push_back(std::make_unique<queue>());
+        }
+
+        _threads.reserve(count);
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            _threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    /// Destructor. Runs the remaining tasks, then joins the workers.
+    inline ~thread_pool()
+    {
+        {
+            std::lock_guard lock(_sleep_mutex);
+            _exiting = true;
+        }
+
+        _sleep_cv.notify_all();
+
+        for(auto& t : _threads)
+        {
+            t.join();
+        }
+    }
+
+    thread_pool(const thread_pool&)            = delete;
+    thread_pool(thread_pool&&)                 = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    thread_pool& operator=(thread_pool&&)      = delete;
+
+    /*********************************************************************/
+    /*                            Execution                              */
+    /*********************************************************************/
+
+    /// Queues 'task' for execution by one of the workers.
+    inline void execute(task_t task)
+    {
+        const std::size_t index = _current_pool == this ? _current_index
+                                                        : _next.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+
+        // Before the push: a worker may take the task, and decrement, as soon as it is queued.
+        _pending.fetch_add(1);
+
+        {
+            queue& q = *_queues[index];
+            std::lock_guard lock(q.mutex);
+            q.push(std::move(task));
+        }
+
+        if(_sleepers.load() != 0)
+        {
+            {
+                std::lock_guard lock(_sleep_mutex);
+            }
+
+            _sleep_cv.notify_one();
+        }
+    }
+
+    /// Returns the number of workers.
+    inline std::size_t thread_count() const
+    {
+        return _threads.size();
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// Pops a task from queue 'index' first, then from the others.
+    inline bool take(const std::size_t index, task_t& task)
+    {
+        for(std::size_t i = 0; i < _queues.size(); ++i)
+        {
+            queue& q = *_queues[(index + i) % _queues.size()];
+
+            // Thieves do not wait for a busy queue.
+            std::unique_lock lock(q.mutex, std::defer_lock);
+
+            if(i == 0)
+            {
+                lock.lock();
+            }
+            else if(!lock.try_lock())
+            {
+                continue;
+            }
+
+            if(q.pop(task))
+            {
+                _pending.fetch_sub(1);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Main loop of worker 'index'.
+    inline void work(const std::size_t index)
+    {
+        _current_pool  = this;
+        _current_index = index;
+
+        task_t task;
+
+        for(;;)
+        {
+            if(take(index, task))
+            {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock lock(_sleep_mutex);
+
+            if(_exiting && _pending.load() == 0)
+            {
+                return;
+            }
+
+            // Dekker-style handshake with execute(): either it sees a sleeper, or we see its task.
+            ++_sleepers;
+            _sleep_cv.wait(lock, [this]() { return _exiting || _pending.load() != 0; });
+            --_sleepers;
+        }
+    }
+};
+
+} //namespace ste
+#endif //STE_thread_pool_HPP
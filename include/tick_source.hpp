@@ -0,0 +1,357 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_tick_source_HPP
+#define STE_tick_source_HPP
+
+#include "inplace_function.hpp"
+
+#include "rcu_cell.hpp"
+
+#include "timer.hpp"
+
+#include <algorithm>
+
+#include <atomic>
+
+#include <chrono>
+
+#include <condition_variable>
+
+#include <cstdint>
+
+#include <mutex>
+
+#include <thread>
+
+#include <type_traits>
+
+#include <vector>
+
+namespace ste
+{
+
+/**
+                                ste::tick_source
+
+    @short One periodic timer whose ticks are fanned out to any number of subscribers.
+
+    @details
+    Features:
+        • One thread (or one service expiration) and one wakeup per tick, however many
+          components subscribe: every subscriber due on a tick is called from that wakeup.
+        • Subscribers are called every 'divider' ticks, counted from their subscription.
+        • subscribe() and unsubscribe() work from any thread, at any time, and a tick never
+          waits for them: subscribers are kept in a contiguous array that the tick walks, and
+          that writers replace as a whole (see ste::rcu_cell).
+        • Copy-on-write: each subscribe() / unsubscribe() copies the whole array, allocating,
+          under a mutex that serialises them. Cheap for the ticks, O(n) for the writers: meant
+          for subscriptions that change rarely compared to the ticks.
+        • Once unsubscribe() returns, the subscriber is not called anymore: it waits, on a
+          condition variable, for a tick that is calling it to end.
+        • The underlying ste::timer is accessible (see timer()) to set its period mode, thread
+          attributes, slack... It uses ste::period_mode::skip by default: ticks stay on the
+          start + k * interval grid.
+
+    Subscribers run one after the other: a slow subscriber delays the others.
+
+        ste::tick_source ticks(std::chrono::milliseconds(1), true);
+        const auto s = ticks.subscribe([]() { poll(); });
+        ticks.subscribe([]() { flush(); }, 10); // Every 10 ms.
+        ticks.unsubscribe(s);
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename function_t = inplace_function<void(void)>>
+class tick_source
+{
+    static_assert (std::is_invocable<const function_t&>::value, "ste::tick_source can only be initialized with an invocable template parameter." );
+
+public:
+
+    /// Identifies a subscriber. 0 is never a valid subscription.
+    using subscription = std::uint64_t;
+
+    using timer_t = ste::timer<inplace_function<void(void)>, std::chrono::nanoseconds, std::chrono::nanoseconds>;
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    struct subscriber
+    {
+        function_t function;
+        std::uint64_t divider;  ///< Called every 'divider' ticks.
+        std::uint64_t phase;    ///< Tick number at subscription, modulo 'divider'.
+        subscription id;
+    };
+
+    /// Subscribers read by the ticks.
+    rcu_cell<std::vector<subscriber>> _subscribers;
+
+    /// Subscribers as modified by subscribe() / unsubscribe(). Published to _subscribers. Protected by _write_mutex.
+    std::vector<subscriber> _pending;
+
+    /// Serialises subscribe() / unsubscribe().
+    mutable std::mutex _write_mutex;
+
+    /// Last subscription given.
+    subscription _last_id = 0;
+
+    /// Set when _pending changed during a tick, on the ticking thread: published when the tick ends.
+    std::atomic<bool> _deferred = false;
+
+    /// Number of ticks dispatched.
+    std::atomic<std::uint64_t> _ticks = 0;
+
+    /// Odd while a tick walks the subscribers.
+    std::atomic<std::uint64_t> _dispatching = 0;
+
+    /// Thread walking the subscribers, if any.
+    std::atomic<std::thread::id> _dispatcher;
+
+    /// Number of unsubscribe() waiting for a tick to end.
+    std::atomic<std::uint32_t> _waiters = 0;
+
+    /// Notified when a tick ends while _waiters is not 0.
+    std::mutex _dispatch_mutex;
+    std::condition_variable _dispatched;
+
+    /// Drives the ticks. Last, so that it stops before the subscribers are destroyed.
+    timer_t _timer;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor. The ticks are driven by a thread of their own.
+     *  @param interval Duration between two ticks.
+     *  @param start (optional) Indicates if the ticks must start immediately. Default is false.
+     */
+    inline explicit tick_source(const std::chrono::nanoseconds interval, const bool start = false)
+        :
+          _subscribers(std::vector<subscriber>()),
+          _timer([this]() { tick(); }, interval, std::chrono::nanoseconds::zero(), false, false)
+    {
+        _timer.set_period_mode(ste::period_mode::skip);
+
+        if(start)
+        {
+            _timer.start();
+        }
+    }
+
+    /**
+     *  @brief Constructor. The ticks are driven by 'service'.
+     *  @param service Service to register with. Must outlive the tick source.
+     *  @param interval Duration between two ticks.
+     *  @param start (optional) Indicates if the ticks must start immediately. Default is false.
+     */
+    inline tick_source(timer_service& service, const std::chrono::nanoseconds interval, const bool start = false)
+        :
+          _subscribers(std::vector<subscriber>()),
+          _timer(service, [this]() { tick(); }, interval, std::chrono::nanoseconds::zero(), false, false)
+    {
+        _timer.set_period_mode(ste::period_mode::skip);
+
+        if(start)
+        {
+            _timer.start();
+        }
+    }
+
+    tick_source(const tick_source&)            = delete;
+    tick_source(tick_source&&)                 = delete;
+    tick_source& operator=(const tick_source&) = delete;
+    tick_source& operator=(tick_source&&)      = delete;
+
+    /*********************************************************************/
+    /*                           Subscriptions                           */
+    /*********************************************************************/
+
+    /**
+     *  @brief  Calls 'function' every 'divider' ticks, the first time 'divider' ticks from now.
+     *  @param  divider (optional) Number of ticks between two calls. Default is 1, 0 is treated as 1.
+     *  @return The subscription, for unsubscribe().
+     *  @note   From a subscriber's function, takes effect at the next tick.
+     */
+    inline subscription subscribe(function_t function, const std::uint64_t divider = 1)
+    {
+        std::lock_guard lock(_write_mutex);
+
+        const std::uint64_t every = std::max<std::uint64_t>(divider, 1);
+
+        _pending.push_back({std::move(function), every, _ticks.load() % every, ++_last_id});
+        publish();
+
+        return _last_id;
+    }
+
+    /**
+     *  @brief  Removes a subscriber. Once this returns, its function is not called anymore,
+     *          except from a subscriber's function, where it takes effect at the next tick.
+     *  @return 'false' if 's' is unknown or already unsubscribed.
+     */
+    inline bool unsubscribe(const subscription s)
+    {
+        {
+            std::lock_guard lock(_write_mutex);
+
+            const auto it = std::find_if(_pending.begin(), _pending.end(), [s](const subscriber& sub) { return sub.id == s; });
+
+            if(it == _pending.end())
+            {
+                return false;
+            }
+
+            _pending.erase(it);
+
+            if(!publish())
+            {
+                return true;
+            }
+        }
+
+        // A tick that started before publish() may still call the subscriber: waits for it to end.
+        const std::uint64_t dispatching = _dispatching.load();
+
+        if(dispatching % 2 != 0)
+        {
+            std::unique_lock lock(_dispatch_mutex);
+
+            ++_waiters;
+            _dispatched.wait(lock, [&]() { return _dispatching.load() != dispatching; });
+            --_waiters;
+        }
+
+        return true;
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Returns the number of subscribers.
+    inline std::size_t subscriber_count() const
+    {
+        std::lock_guard lock(_write_mutex);
+        return _pending.size();
+    }
+
+    /// Returns the number of ticks dispatched since the tick source was created.
+    inline std::uint64_t ticks() const
+    {
+        return _ticks.load();
+    }
+
+    /// Starts the ticks. Nothing happens if they are already started.
+    inline void start()
+    {
+        _timer.start();
+    }
+
+    /// Stops the ticks.
+    inline void stop()
+    {
+        _timer.stop();
+    }
+
+    /// Returns the timer that drives the ticks.
+    inline timer_t& timer()
+    {
+        return _timer;
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /**
+     *  @brief  Makes _pending visible to the ticks. Requires _write_mutex.
+     *  @return 'false' if called from a tick, in which case it is published when the tick ends.
+     */
+    inline bool publish()
+    {
+        // Replacing the array from inside a read of it could wait for that very read.
+        if(std::this_thread::get_id() == _dispatcher.load())
+        {
+            _deferred = true;
+            return false;
+        }
+
+        _subscribers.store(_pending);
+        return true;
+    }
+
+    /// Timer function: calls the subscribers due on this tick.
+    inline void tick()
+    {
+        const std::uint64_t tick = _ticks.fetch_add(1) + 1;
+
+        _dispatcher = std::this_thread::get_id();
+        ++_dispatching;
+
+        _subscribers.read([tick](const std::vector<subscriber>& subscribers)
+        {
+            for(const subscriber& s : subscribers)
+            {
+                if(s.divider == 1 || tick % s.divider == s.phase)
+                {
+                    s.function();
+                }
+            }
+        });
+
+        ++_dispatching;
+        _dispatcher = std::thread::id();
+
+        // Seen by any waiter that registered before the increment: it checks _dispatching after.
+        if(_waiters.load() != 0)
+        {
+            std::lock_guard lock(_dispatch_mutex);
+            _dispatched.notify_all();
+        }
+
+        if(_deferred.exchange(false))
+        {
+            std::lock_guard lock(_write_mutex);
+            _subscribers.store(_pending);
+        }
+    }
+};
+
+} //namespace ste
+#endif //STE_tick_source_HPP
@@ -30,21 +30,179 @@
 #ifndef STE_timer_HPP
 #define STE_timer_HPP
 
+#include "executor.hpp"
+
+#include "rcu_cell.hpp"
+
+#include "thread_attributes.hpp"
+
+#include "timer_service.hpp"
+
+#if defined(STE_TIMER_STATS)
+#include "timer_stats.hpp"
+#endif
+
+#if defined(STE_TIMER_TRACE)
+#include "trace.hpp"
+#endif
+
+#include <algorithm>
+
 #include <atomic>
 
 #include <chrono>
 
+#include <condition_variable>
+
+#include <cstdint>
+
 #include <mutex>
 
+#include <optional>
+
 #include <ostream>
 
+#include <random>
+
+#include <ratio>
+
+#include <stdexcept>
+
+#include <string>
+
 #include <thread>
 
 #include <type_traits>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
 namespace ste
 {
 
+/// Lateness of the calls of a timer: time between each deadline and the actual call.
+struct jitter_stats
+{
+    std::uint64_t samples;          ///< Number of calls measured.
+    std::chrono::nanoseconds last;  ///< Lateness of the last call.
+    std::chrono::nanoseconds mean;  ///< Mean lateness.
+    std::chrono::nanoseconds max;   ///< Worst lateness.
+};
+
+namespace detail
+{
+
+/// 'true' if 'type_t' is a std::chrono::duration.
+template<typename type_t>
+struct is_duration : std::false_type {};
+
+template<typename rep_t, typename period_t>
+struct is_duration<std::chrono::duration<rep_t, period_t>> : std::true_type {};
+
+template<typename type_t>
+inline constexpr bool is_duration_v = is_duration<type_t>::value;
+
+/// 'true' if 'function_t' takes the interval it returned last time (see ste::backoff).
+template<typename function_t>
+inline constexpr bool takes_previous_v = std::is_invocable_v<function_t&, std::chrono::nanoseconds>;
+
+/// Type returned by the calls of 'function_t', with or without the previous interval.
+template<typename function_t, bool = takes_previous_v<function_t>>
+struct call_result
+{
+    using type = std::decay_t<std::invoke_result_t<function_t&>>;
+};
+
+template<typename function_t>
+struct call_result<function_t, true>
+{
+    using type = std::decay_t<std::invoke_result_t<function_t&, std::chrono::nanoseconds>>;
+};
+
+template<typename function_t>
+using call_result_t = typename call_result<function_t>::type;
+
+/// Returns the unit of 'duration_t' for printing: "ms" for milliseconds, "[1/60]s" for a custom ratio.
+template<typename duration_t>
+inline std::string duration_unit()
+{
+    using period = typename duration_t::period;
+
+    if constexpr(std::is_same_v<period, std::nano>)             { return "ns"; }
+    else if constexpr(std::is_same_v<period, std::micro>)       { return "us"; }
+    else if constexpr(std::is_same_v<period, std::milli>)       { return "ms"; }
+    else if constexpr(std::is_same_v<period, std::ratio<1>>)    { return "s"; }
+    else if constexpr(std::is_same_v<period, std::ratio<60>>)   { return "min"; }
+    else if constexpr(std::is_same_v<period, std::ratio<3600>>) { return "h"; }
+    else if constexpr(period::den == 1)
+    {
+        return "[" + std::to_string(period::num) + "]s";
+    }
+    else
+    {
+        return "[" + std::to_string(period::num) + "/" + std::to_string(period::den) + "]s";
+    }
+}
+
+/// SplitMix64 finalizer: spreads the bits of 'x' over the whole 64-bit range.
+inline std::uint64_t mix(std::uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9u;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBu;
+    return x ^ (x >> 31);
+}
+
+/// Fast per-thread pseudo-random numbers, for jitter. Not for anything that needs to be unpredictable.
+inline std::uint64_t random_u64()
+{
+    thread_local std::uint64_t state = (static_cast<std::uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    return mix(state += 0x9E3779B97F4A7C15u);
+}
+
+/// Maps 'x' to [0, 1).
+inline double unit_interval(const std::uint64_t x)
+{
+    return static_cast<double>(x >> 11) * 0x1.0p-53;
+}
+
+/// Position of the next timer started with ste::phase_mode::spread.
+inline std::atomic<std::uint64_t> spread_sequence = 0;
+
+/// Hints the CPU that the calling thread is busy-waiting.
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+} //namespace detail
+
+/// How a periodic timer computes its deadlines, and what it does when a call overruns them.
+enum class period_mode
+{
+    relative,   ///< Waits 'interval' after each call returns (or is handed off). The period drifts by the call duration.
+    catch_up,   ///< Absolute deadlines (start + k * interval). Missed ticks are fired back to back.
+    skip,       ///< Absolute deadlines. Missed ticks are dropped, the original phase is kept.
+    reanchor    ///< Absolute deadlines. After an overrun, the schedule restarts from the current time.
+};
+
+/// How the first call of a timer is offset from start() + delay, so that timers started together do not fire together.
+enum class phase_mode
+{
+    none,       ///< No offset.
+    random,     ///< Random offset in [0, bound).
+    hashed,     ///< Offset in [0, bound) derived from a key: the same key always gives the same phase.
+    spread      ///< Successive timers are spread evenly over [0, bound), however many there are (golden ratio sequence).
+};
+
 /**
                                 ste::timer
 
@@ -54,7 +212,36 @@ namespace ste
     Features:
         • Can call any function.
         • Single shot or loop execution editable at runtime.
+        • Drift-free periodic execution against absolute deadlines, with a selectable
+          overrun policy (see ste::period_mode).
         • Function change while running (provided the two decltype()s are identical).
+          The timer thread never blocks on set_function() (see ste::rcu_cell).
+        • Optional registration with a ste::timer_service, in which case the timer does not
+          create any thread and is served by the service's dispatcher(s) instead.
+        • Any clock: std::chrono::steady_clock (default), std::chrono::system_clock, or a
+          simulated clock such as ste::manual_clock, whose timers always use its service and
+          fire deterministically when the clock is advanced.
+        • stop(), set_interval() and set_delay() interrupt the current wait immediately.
+        • Adaptive intervals: a function that returns a std::chrono::duration sets the interval
+          before the next call, one that returns 'false' stops the timer. The returned value
+          goes straight to the next wait. A function returning a duration may take the one it
+          returned last time as a std::chrono::nanoseconds argument, zero on the first call
+          after start(): the timer keeps that state, not the function (see ste::backoff).
+          Durations cannot be returned through an executor (see set_executor()).
+        • Optional high-precision waits: sleep until shortly before the deadline, then spin.
+          The lateness of each call is measured (see jitter()).
+        • One persistent thread per timer, created by the first start() and parked while the
+          timer is stopped: start() / stop() never create threads nor allocate, and at most
+          one call loop is ever active. The destructor joins the thread.
+        • Optional hand-off of the calls to an executor (e.g. ste::thread_pool): the timer
+          thread only detects expirations, so slow functions no longer delay the next ticks.
+          The number of concurrent calls of one timer is bounded (see set_max_concurrency()).
+        • Optional slack: calls may be delayed by up to slack() so that the wakeups of several
+          timers are grouped, by the ste::timer_service or by the kernel (Linux timer slack).
+        • Optional lateness / duration histograms and fire / skip / overrun counters,
+          compiled in only if STE_TIMER_STATS is defined (see stats()).
+        • Optional trace of starts, stops, calls and overruns to memory-mapped ring buffers,
+          compiled in only if STE_TIMER_TRACE is defined (see ste::trace).
 
      @copyright     Copyright (C) <2020-2022>  DUHAMEL Erwan
 
@@ -89,24 +276,26 @@ namespace ste
 template<typename function_t,
          typename delay_t,
          typename interval_t,
-         typename            = std::enable_if_t<std::is_same_v<delay_t, std::chrono::nanoseconds>  ||
-                                                std::is_same_v<delay_t, std::chrono::microseconds> ||
-                                                std::is_same_v<delay_t, std::chrono::milliseconds> ||
-                                                std::is_same_v<delay_t, std::chrono::seconds>      ||
-                                                std::is_same_v<delay_t, std::chrono::minutes>      ||
-                                                std::is_same_v<delay_t, std::chrono::hours>
-                                                >,
-         typename            = std::enable_if_t<std::is_same_v<interval_t, std::chrono::nanoseconds>  ||
-                                                std::is_same_v<interval_t, std::chrono::microseconds> ||
-                                                std::is_same_v<interval_t, std::chrono::milliseconds> ||
-                                                std::is_same_v<interval_t, std::chrono::seconds>      ||
-                                                std::is_same_v<interval_t, std::chrono::minutes>      ||
-                                                std::is_same_v<interval_t, std::chrono::hours>
-                                                >
+         typename clock_t = std::chrono::steady_clock
          >
 class timer
 {
-    static_assert (std::is_invocable<function_t>::value, "ste::timer can only be initialized with an invocable template parameter." );
+    static_assert (std::is_invocable<function_t>::value || detail::takes_previous_v<function_t>, "ste::timer can only be initialized with an invocable template parameter." );
+    static_assert (detail::is_duration_v<delay_t>, "ste::timer delay must be a std::chrono::duration." );
+    static_assert (detail::is_duration_v<interval_t>, "ste::timer interval must be a std::chrono::duration." );
+    static_assert (std::is_void_v<detail::call_result_t<function_t>> ||
+                   std::is_same_v<detail::call_result_t<function_t>, bool> ||
+                   detail::is_duration_v<detail::call_result_t<function_t>>,
+                   "ste::timer function must return void, bool (false stops the timer) or a std::chrono::duration (the next interval)." );
+    static_assert (!detail::takes_previous_v<function_t> || detail::is_duration_v<detail::call_result_t<function_t>>,
+                   "ste::timer function taking the previous interval must return the next one, a std::chrono::duration." );
+
+public:
+
+    /// Service the timer can be registered with.
+    using service_type = basic_timer_service<clock_t>;
+    /// Point in time of 'clock_t'.
+    using time_point   = typename clock_t::time_point;
 
 private:
 
@@ -126,11 +315,106 @@ private:
     /// Delay before the timer stops.
     std::atomic<delay_t> _delay;
 
-    /// Function to call
-    function_t _function;
+    /// How deadlines are computed in continuous mode.
+    std::atomic<ste::period_mode> _period_mode = ste::period_mode::relative;
+
+    /// Offset of the first call (see set_phase()).
+    std::atomic<ste::phase_mode> _phase_mode = ste::phase_mode::none;
+    std::atomic<std::chrono::nanoseconds> _phase_bound = std::chrono::nanoseconds::zero();
+    std::atomic<std::uint64_t> _phase_key = 0;
+
+    /// Width of the random offset of each deadline around the schedule (see set_tick_jitter()).
+    std::atomic<std::chrono::nanoseconds> _tick_jitter = std::chrono::nanoseconds::zero();
+
+    /// Number of ticks that were not fired on time (see missed_ticks()).
+    std::atomic<std::uint64_t> _missed_ticks = 0;
+
+    /// Waits end this long before the deadline, the rest is spent spinning. 0 disables spinning.
+    std::atomic<std::chrono::nanoseconds> _spin_threshold = std::chrono::nanoseconds::zero();
 
-    /// Mutex used to protect read / write access when changing function.
-    std::mutex _write_mutex;
+    /// How late a call may be, so that its wakeup is grouped with others (see set_slack()).
+    std::atomic<std::chrono::nanoseconds> _slack = std::chrono::nanoseconds::zero();
+
+    /// Kernel timer slack currently applied to the worker. Only accessed by the worker.
+    std::chrono::nanoseconds _applied_slack = std::chrono::nanoseconds::zero();
+
+    /// Lateness measurements, in nanoseconds (see jitter()).
+    std::atomic<std::uint64_t> _jitter_samples = 0;
+    std::atomic<std::int64_t> _jitter_last = 0;
+    std::atomic<std::int64_t> _jitter_sum  = 0;
+    std::atomic<std::int64_t> _jitter_max  = 0;
+
+#if defined(STE_TIMER_STATS)
+    /// Lateness and duration histograms (see stats()).
+    timer_stats _stats;
+#endif
+
+    /// Function to call. Swapped by set_function() without blocking the timer thread.
+    rcu_cell<function_t> _function;
+
+    /// Executor the calls are handed off to. Null if the function is called by the timer thread.
+    /// Protected by _executor_mutex.
+    executor_ref _executor;
+
+    /// Held while a call is handed off, so that set_executor() never races with a submission.
+    std::mutex _executor_mutex;
+
+    /// Maximum number of calls in progress on _executor. 0 means no limit.
+    std::atomic<std::size_t> _max_concurrency = 1;
+
+    /// Number of calls submitted to _executor that have not returned yet. Modified under _wait_mutex.
+    std::atomic<std::size_t> _in_flight = 0;
+
+    /// Service the timer is registered with. nullptr if the timer uses its own thread.
+    service_type* _service = nullptr;
+
+    /// Pending expiration in _service.
+    typename service_type::id _service_id = 0;
+
+    /// Deadline of the pending expiration in _service. Protected by _service_mutex.
+    time_point _service_deadline;
+
+    /// Time the next service deadline is computed from. Protected by _service_mutex.
+    time_point _service_base;
+
+    /// 'true' until the first call when registered with a service. Protected by _service_mutex.
+    bool _service_first = false;
+
+    /// Offset of the pending service expiration from the schedule (see set_tick_jitter()). Protected by _service_mutex.
+    typename clock_t::duration _service_jitter = {};
+
+    /// Interval before the next service expiration returned by the function, if any. Protected by _service_mutex.
+    std::optional<typename clock_t::duration> _service_delay;
+
+    /// Protects _service_id against concurrent start() / stop() / re-arming.
+    std::mutex _service_mutex;
+
+    /// Worker running the call loop when the timer is not registered with a service.
+    /// Created by the first start(), parked while the timer is stopped. Protected by _wait_mutex.
+    attributed_thread _thread;
+
+    /// Attributes of the next worker (see set_thread_attributes()). Protected by _wait_mutex.
+    thread_attributes _thread_attributes;
+
+    /// What could not be applied to the worker (see thread_status()). Protected by _wait_mutex.
+    thread_attributes_status _thread_status;
+
+    /// Protects the waits of the call loop. Held by the mutators before notifying.
+    mutable std::mutex _wait_mutex;
+
+    /// Wakes the worker on start(), stop(), reconfiguration or destruction.
+    std::condition_variable _wait_cv;
+
+    /// Incremented by set_interval() / set_delay() so that the current wait is recomputed.
+    /// Written under _wait_mutex, read without it while spinning.
+    std::atomic<std::uint64_t> _config_epoch = 0;
+
+    /// Incremented by each effective start() so that the worker restarts its schedule.
+    /// Written under _wait_mutex, read without it while spinning.
+    std::atomic<std::uint64_t> _run_epoch = 0;
+
+    /// Set by the destructor to terminate the worker. Protected by _wait_mutex.
+    bool _exiting = false;
 
 public:
 
@@ -154,11 +438,12 @@ public:
                  const bool single_shot = true,
                  const bool start       = false)
         :
-          _stopped(!start),               //ste::timer is stopped when declared.
+          _stopped(true),                 //ste::timer is stopped when declared.
           _single_shot(single_shot),
           _delay(delay),
           _interval(interval),
-          _function(function)
+          _function(std::move(function)),
+          _service(default_service())
     {
         if(start)
         {
@@ -188,10 +473,65 @@ public:
                 start)
     {}
 
-    /// Destructor. Stops the timer if it is running.
+    /**
+     *  @brief Constructor. The timer is served by 'service' instead of its own thread.
+     *  @param service Service to register with. Must outlive the timer.
+     *  @param function Function to call.
+     *  @param interval Duration between calls.
+     *  @param delay (optional) Duration to wait before the timer starts its call loop. Default is {}.
+     *  @param single_shot (optional) Indicates if timer must execute its function
+     *                                until lifetime expires or stop() is called.
+     *                                Default is true.
+     *  @param start (optional) Indicates if the timer must be started immediately. Default is false.
+     */
+    inline timer(service_type& service,
+                 function_t function,
+                 const interval_t interval,
+                 const delay_t delay    = {},
+                 const bool single_shot = true,
+                 const bool start       = false)
+        : timer(function, interval, delay, single_shot, false)
+    {
+        _service = &service;
+
+        if(start)
+        {
+            this->start();
+        }
+    }
+
+    /**
+     *  @brief Constructor. The timer is served by 'service' instead of its own thread.
+     *  @param service Service to register with. Must outlive the timer.
+     *  @param function Function to call.
+     *  @param interval Duration between calls.
+     *  @param delay (optional) Duration to wait before the timer starts its call loop. Default is 0.
+     *  @param single_shot (optional) Indicates if timer must execute its function
+     *                                until lifetime expires or stop() is called.
+     *                                Default is true.
+     *  @param start (optional) Indicates if the timer must be started immediately. Default is false.
+     */
+    inline timer(service_type& service,
+                 function_t function,
+                 const std::uint64_t interval,
+                 const std::uint64_t delay    = 0,
+                 const bool single_shot       = true,
+                 const bool start             = false)
+        : timer(service,
+                function,
+                static_cast<interval_t>(interval),
+                static_cast<delay_t>(delay),
+                single_shot,
+                start)
+    {}
+
+    /// Destructor. Stops the timer, waits for the calls in progress and joins its worker.
+    /// Must not be called from the timer's function.
     inline ~timer()
     {
-        stop(); // Call loop thread exits at some point after that
+        stop(); // Service callbacks are waited for by stop().
+        retire_worker(); // Before wait_idle(): the worker may be about to submit a call.
+        wait_idle();
     }
 
     timer(const timer&)            = delete;
@@ -203,63 +543,194 @@ public:
     /*                         Timer management                          */
     /*********************************************************************/
 
-    /// Starts the timer. Nothing happens if the timer is already started.
+    /**
+     *  @brief Starts the timer. Nothing happens if the timer is already started.
+     *  @throw std::invalid_argument on a simulated clock (see ste::manual_clock) if the timer is
+     *         continuous with a zero interval: simulated time would never move past its calls.
+     */
     inline void start()
     {
-        if(_stopped)
+        if(_service != nullptr)
         {
-            const auto on_run = [this]() -> void
-            {
-                const auto delay = this->delay();
+            std::lock_guard lock(_service_mutex);
 
-                if(delay.count() != 0)
-                {
-                    std::this_thread::sleep_for(_delay.load());
-                }
-
-                do
+            if(_stopped)
+            {
+                if constexpr(detail::has_service_v<clock_t> && !detail::is_duration_v<detail::call_result_t<function_t>>)
                 {
-                    const interval_t interval = this->interval();
-
-                    if(_stopped)
-                    {
-                        return;
-                    }
-
-                    if(interval.count() != 0)
+                    if(!_single_shot && interval() == interval_t::zero())
                     {
-                        std::this_thread::sleep_for(interval);
+                        throw std::invalid_argument("ste::timer: a continuous timer on a simulated clock requires a non-zero interval");
                     }
+                }
 
-                    if(_stopped)
-                    {
-                        return;
-                    }
+                _stopped          = false;
+                _service_first    = true;
+                _service_delay.reset();
+                _service_base     = clock_t::now() + phase_offset();
+                _service_jitter   = tick_offset();
+                _service_deadline = service_deadline();
+                _service_id       = _service->schedule_at(_service_deadline, [this]() { on_service_tick(); }, slack());
+
+#if defined(STE_TIMER_TRACE)
+                trace::record(trace::event_type::start, this);
+#endif
+            }
 
-                    _function();
-                }
-                while(!_single_shot); //Also return if set to single shot mode while in the loop
+            return;
+        }
 
-                _stopped = true;
-            };
+        {
+            std::lock_guard lock(_wait_mutex);
 
-            std::thread t(on_run);
-            t.detach();
+            if(!_stopped)
+            {
+                return;
+            }
 
             _stopped = false;
+            ++_run_epoch;
+
+#if defined(STE_TIMER_TRACE)
+            trace::record(trace::event_type::start, this);
+#endif
+
+            if(!_thread.joinable())
+            {
+                _thread        = attributed_thread(_thread_attributes, [this]() { run(); });
+                _thread_status = _thread.status();
+            }
         }
+
+        _wait_cv.notify_all();
     }
 
-    /// Stops the timer.
+    /// Stops the timer. Takes effect immediately, even if the timer is waiting.
     inline void stop()
     {
-        _stopped = true;
+        const bool was_stopped = set_stopped(true);
+
+#if defined(STE_TIMER_TRACE)
+        if(!was_stopped)
+        {
+            trace::record(trace::event_type::stop, this);
+        }
+#else
+        static_cast<void>(was_stopped);
+#endif
+
+        if(_service != nullptr)
+        {
+            typename service_type::id pending = 0;
+
+            {
+                std::lock_guard lock(_service_mutex);
+                std::swap(pending, _service_id);
+            }
+
+            // Outside of the lock: cancel() waits for a running on_service_tick(), which locks it.
+            _service->cancel(pending);
+        }
     }
 
     /*********************************************************************/
     /*                       Accessors / Mutators                        */
     /*********************************************************************/
 
+    /**
+     *  @brief Registers the timer with a service, or with none if 'service' is nullptr.
+     *  @note  The timer is stopped first. 'service' must outlive the timer.
+     *         With a clock that drives its own service (e.g. ste::manual_clock), nullptr
+     *         registers the timer with clock_t::service().
+     */
+    inline void set_service(service_type* service)
+    {
+        stop();
+        _service = service != nullptr ? service : default_service();
+    }
+
+    /**
+     *  @brief Sets the scheduling policy, affinity, stack size and name of the timer thread.
+     *         Settings that cannot be applied are skipped and reported by thread_status().
+     *  @note  The timer is stopped first, and its thread is replaced at the next start().
+     *         Ignored while the timer is registered with a service: the service's own
+     *         threads take ste::thread_attributes at construction.
+     *         Must not be called from the timer's function.
+     */
+    inline void set_thread_attributes(const thread_attributes& attributes)
+    {
+        stop();
+        retire_worker();
+
+        std::lock_guard lock(_wait_mutex);
+        _thread_attributes = attributes;
+    }
+
+    /// Returns what could not be applied to the current timer thread, if any.
+    inline thread_attributes_status thread_status() const
+    {
+        std::lock_guard lock(_wait_mutex);
+        return _thread_status;
+    }
+
+    /// Returns the service the timer is registered with, nullptr if it uses its own thread.
+    inline service_type* service() const
+    {
+        return _service;
+    }
+
+    /**
+     *  @brief Hands the calls off to 'executor' instead of calling the function on the timer thread.
+     *         A null reference (the default) restores direct calls.
+     *  @note  Waits for the calls in progress on the previous executor. 'executor' must outlive
+     *         the timer, or the next call to set_executor(). Must not be called from the timer's
+     *         function, nor with an executor that runs its tasks inside execute().
+     *         A call that returns 'false' stops the timer when it returns: ticks that expired
+     *         meanwhile still run. Functions returning a duration do not compile with this: the
+     *         next tick is scheduled before the call returns.
+     */
+    inline void set_executor(const executor_ref executor)
+    {
+        static_assert (!detail::is_duration_v<detail::call_result_t<function_t>>,
+                       "ste::timer functions returning the next interval cannot be handed off to an executor." );
+
+        {
+            std::lock_guard lock(_executor_mutex);
+            _executor = executor;
+        }
+
+        wait_idle();
+    }
+
+    /// Returns the executor the calls are handed off to, a null reference if there is none.
+    inline executor_ref executor()
+    {
+        std::lock_guard lock(_executor_mutex);
+        return _executor;
+    }
+
+    /**
+     *  @brief Sets the maximum number of calls of this timer running at the same time on its
+     *         executor. 0 means no limit. Default is 1: calls never overlap.
+     *  @note  A tick that would exceed the limit is dropped and counted in missed_ticks().
+     */
+    inline void set_max_concurrency(const std::size_t max)
+    {
+        _max_concurrency = max;
+    }
+
+    /// Returns the maximum number of concurrent calls on the executor (see set_max_concurrency()).
+    inline std::size_t max_concurrency() const
+    {
+        return _max_concurrency.load();
+    }
+
+    /// Returns the number of calls submitted to the executor that have not returned yet.
+    inline std::size_t calls_in_progress() const
+    {
+        return _in_flight.load();
+    }
+
     /// Returns 'true' if the timer is running, 'false' otherwise.
     inline bool running() const
     {
@@ -284,10 +755,11 @@ public:
         return _single_shot;
     }
 
-    /// Sets timer delay (duration before first call).
+    /// Sets timer delay (duration before first call). Interrupts and recomputes a pending initial wait.
     inline void set_delay(const delay_t delay)
     {
         _delay = delay;
+        reconfigure();
     }
 
     /// Sets timer delay (duration before first call).
@@ -302,10 +774,14 @@ public:
         return _delay.load();
     }
 
-    /// Sets timer interval (duration between calls).
+    /**
+     *  @brief Sets timer interval (duration between calls). Interrupts and recomputes a pending wait.
+     *  @note  On a simulated clock, the calls of a zero interval are one clock tick apart.
+     */
     inline void set_interval(const interval_t interval)
     {
         _interval = interval;
+        reconfigure();
     }
 
     /// Sets timer interval (duration between calls).
@@ -321,97 +797,742 @@ public:
     }
 
     /**
-     *  Sets the function called by the timer.
-     *  @note std::lock_guard protects access from timer thread.
+     *  @brief Allows each call to happen up to 'slack' after its deadline, so that its wakeup can
+     *         be shared with other timers. Zero (the default) requests exact calls. Takes effect
+     *         at the next tick.
+     *  @note  With a ste::timer_service, overlapping windows are served by one wakeup (see
+     *         ste::timer_service::coalesced_wakeups()). Otherwise, on Linux, 'slack' becomes the
+     *         kernel timer slack of the worker thread (PR_SET_TIMERSLACK), zero restoring the
+     *         default of 50us. Elsewhere, it has no effect on a thread-based timer.
      */
-    inline void set_function(function_t func)
+    inline void set_slack(const std::chrono::nanoseconds slack)
     {
-        std::lock_guard lock (_write_mutex);
-        _function = func;
+        _slack = std::max(slack, std::chrono::nanoseconds::zero());
     }
 
-    /// Returns a copy of the function called by the timer.
-    inline function_t function() const
+    /// Returns how late a call may be (see set_slack()).
+    inline std::chrono::nanoseconds slack() const
     {
-        return _function;
+        return _slack.load();
     }
 
-    /*********************************************************************/
-    /*                            Operators                              */
-    /*********************************************************************/
+    /// Sets how deadlines are computed in continuous mode. Takes effect at the next tick.
+    inline void set_period_mode(const ste::period_mode mode)
+    {
+        _period_mode = mode;
+    }
 
-    inline friend std::ostream& operator<<(std::ostream& out, const timer& t)
+    /// Returns how deadlines are computed in continuous mode.
+    inline ste::period_mode period_mode() const
     {
-        // TODO: replace by templated lambda when C++20 support becomes wider.
+        return _period_mode.load();
+    }
 
-        constexpr auto delay_unit = []() constexpr -> std::string_view
-        {
-            if constexpr(std::is_same_v<delay_t, std::chrono::nanoseconds>)
-            {
-                return "ns";
-            }
-            else if constexpr(std::is_same_v<delay_t, std::chrono::microseconds>)
-            {
-                return "us";
-            }
-            else if constexpr(std::is_same_v<delay_t, std::chrono::milliseconds>)
-            {
-                return "ms";
-            }
-            else if constexpr(std::is_same_v<delay_t, std::chrono::seconds>)
-            {
-                return "s";
-            }
-            else if constexpr(std::is_same_v<delay_t, std::chrono::minutes>)
-            {
-                return "min";
-            }
-            else if constexpr(std::is_same_v<delay_t, std::chrono::hours>)
-            {
-                return "h";
-            }
-            else
-            {
-                return "?";
-            }
-        }();
+    /**
+     *  @brief Offsets the first call by a phase in [0, bound), so that timers started together are
+     *         spread over their interval instead of firing together forever. Takes effect at the next start().
+     *  @param mode How the phase is chosen (see ste::phase_mode).
+     *  @param bound (optional) Upper bound of the phase. Default is 0, for the interval.
+     *  @param key (optional) Identifies the timer with ste::phase_mode::hashed. Default is 0.
+     *  @note  Only the phase changes: the period, hence the long-term rate, does not.
+     *         Construct the timer with start = false, or the first run has no phase.
+     */
+    inline void set_phase(const ste::phase_mode mode,
+                          const std::chrono::nanoseconds bound = std::chrono::nanoseconds::zero(),
+                          const std::uint64_t key = 0)
+    {
+        _phase_bound = std::max(bound, std::chrono::nanoseconds::zero());
+        _phase_key   = key;
+        _phase_mode  = mode;
+    }
 
-        constexpr auto interval_unit = []() constexpr -> std::string_view
-        {
-            if constexpr(std::is_same_v<interval_t, std::chrono::nanoseconds>)
-            {
-                return "ns";
-            }
-            else if constexpr(std::is_same_v<interval_t, std::chrono::microseconds>)
-            {
-                return "us";
-            }
-            else if constexpr(std::is_same_v<interval_t, std::chrono::milliseconds>)
-            {
-                return "ms";
-            }
-            else if constexpr(std::is_same_v<interval_t, std::chrono::seconds>)
-            {
-                return "s";
-            }
-            else if constexpr(std::is_same_v<interval_t, std::chrono::minutes>)
-            {
-                return "min";
-            }
-            else if constexpr(std::is_same_v<interval_t, std::chrono::hours>)
-            {
-                return "h";
-            }
-            else
-            {
-                return "?";
-            }
-        }();
+    /// Returns how the phase of the first call is chosen (see set_phase()).
+    inline ste::phase_mode phase_mode() const
+    {
+        return _phase_mode.load();
+    }
+
+    /**
+     *  @brief Moves each deadline by a random offset in [-jitter / 2, jitter / 2), so that periodic
+     *         timers do not stay aligned. Zero (the default) disables it. Takes effect at the next tick.
+     *  @note  The offsets do not accumulate: in absolute period modes, deadline k stays within
+     *         jitter / 2 of start + k * interval, so the long-term rate does not change.
+     *         'jitter' is capped at the interval.
+     */
+    inline void set_tick_jitter(const std::chrono::nanoseconds jitter)
+    {
+        _tick_jitter = std::max(jitter, std::chrono::nanoseconds::zero());
+    }
+
+    /// Returns the width of the random offset of each deadline (see set_tick_jitter()).
+    inline std::chrono::nanoseconds tick_jitter() const
+    {
+        return _tick_jitter.load();
+    }
+
+    /**
+     *  @brief Returns the number of ticks that were not fired on time because a call overran them.
+     *  @note  With ste::period_mode::catch_up these ticks were fired late, with
+     *         ste::period_mode::skip and ste::period_mode::reanchor they were dropped.
+     *         Always 0 with ste::period_mode::relative.
+     *         Also counts the ticks dropped because the executor already ran max_concurrency() calls.
+     */
+    inline std::uint64_t missed_ticks() const
+    {
+        return _missed_ticks.load();
+    }
+
+    /**
+     *  @brief Enables high-precision waits: the timer thread sleeps until 'threshold' before
+     *         each deadline, then spins until the deadline. Zero (the default) disables spinning.
+     *  @note  Trades one busy core for up to 'threshold' per call for a much smaller lateness,
+     *         typically a few microseconds instead of 50-100 us on Linux.
+     *         Has no effect when the timer is registered with a ste::timer_service.
+     */
+    inline void set_spin_threshold(const std::chrono::nanoseconds threshold)
+    {
+        _spin_threshold = std::max(threshold, std::chrono::nanoseconds::zero());
+        reconfigure();
+    }
+
+    /// Returns the spin threshold (see set_spin_threshold()).
+    inline std::chrono::nanoseconds spin_threshold() const
+    {
+        return _spin_threshold.load();
+    }
+
+    /// Returns the lateness statistics of the calls since the timer was created or reset_jitter() was called.
+    inline jitter_stats jitter() const
+    {
+        const auto samples = _jitter_samples.load();
+
+        return {samples,
+                std::chrono::nanoseconds(_jitter_last.load()),
+                std::chrono::nanoseconds(samples == 0 ? 0 : _jitter_sum.load() / static_cast<std::int64_t>(samples)),
+                std::chrono::nanoseconds(_jitter_max.load())};
+    }
+
+    /// Clears the lateness statistics.
+    inline void reset_jitter()
+    {
+        _jitter_samples = 0;
+        _jitter_last    = 0;
+        _jitter_sum     = 0;
+        _jitter_max     = 0;
+    }
+
+#if defined(STE_TIMER_STATS)
+    /// Returns the statistics recorded since the timer was created or reset_stats() was called.
+    inline timer_stats_snapshot stats() const
+    {
+        return _stats.snapshot();
+    }
+
+    /// Clears the statistics.
+    inline void reset_stats()
+    {
+        _stats.reset();
+    }
+#endif
+
+    /**
+     *  Sets the function called by the timer.
+     *  @note A call in progress completes with the previous function. The timer thread never
+     *        waits for this function, which may wait for calls that still use an older function.
+     *        From the timer's own function, never waits: after two calls in the same invocation,
+     *        the function is replaced when the invocation returns (see ste::rcu_cell).
+     */
+    inline void set_function(function_t func)
+    {
+        _function.store(std::move(func));
+    }
+
+    /// Returns a copy of the function called by the timer.
+    inline function_t function() const
+    {
+        return _function.load();
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// What the function asked for, through its return value.
+    struct next_call
+    {
+        bool stop = false;                                  ///< Returned 'false'.
+        std::optional<typename clock_t::duration> delay;    ///< Returned the interval before the next call.
+    };
+
+    /// Records the lateness of a call scheduled at 'deadline', then calls the current function
+    /// or hands it off to the executor. 'previous': interval returned by the last call, zero if none.
+    inline next_call call(const time_point deadline, const std::chrono::nanoseconds previous)
+    {
+        const auto lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - deadline).count();
+
+        _jitter_last.store(lateness, std::memory_order_relaxed);
+        _jitter_sum.fetch_add(lateness, std::memory_order_relaxed);
+        _jitter_samples.fetch_add(1, std::memory_order_relaxed);
+
+        if(lateness > _jitter_max.load(std::memory_order_relaxed))
+        {
+            _jitter_max.store(lateness, std::memory_order_relaxed);
+        }
+
+#if defined(STE_TIMER_STATS)
+        _stats.record_fire(std::chrono::nanoseconds(lateness));
+#endif
+
+        {
+            std::lock_guard lock(_executor_mutex);
+
+            if(_executor)
+            {
+                {
+                    // Under the lock of stop() and wait_idle(): either the timer is seen stopped,
+                    // or the call is counted before wait_idle() reads the count.
+                    std::lock_guard wait_lock(_wait_mutex);
+
+                    if(_stopped)
+                    {
+                        return {};
+                    }
+
+                    const auto max = _max_concurrency.load(std::memory_order_relaxed);
+
+                    if(max != 0 && _in_flight >= max)
+                    {
+                        ++_missed_ticks;
+#if defined(STE_TIMER_STATS)
+                        _stats.record_skips(1);
+#endif
+                        return {};
+                    }
+
+                    ++_in_flight;
+                }
+
+                // The call has not returned when the next tick is scheduled: only 'false' can
+                // be honoured, once it returns. set_executor() rejects durations.
+                _executor.execute([this, lateness]()
+                {
+                    if(invoke(lateness, std::chrono::nanoseconds::zero()).stop)
+                    {
+                        stop();
+                    }
+
+                    // Under the lock: the destructor may run as soon as the count reaches 0.
+                    std::lock_guard lock(_wait_mutex);
+
+                    if(--_in_flight == 0)
+                    {
+                        _wait_cv.notify_all();
+                    }
+                });
+
+                return {};
+            }
+        }
+
+        return invoke(lateness, previous);
+    }
+
+    /// Calls the current function, and measures the call if statistics or tracing are enabled.
+    inline next_call invoke([[maybe_unused]] const std::int64_t lateness, [[maybe_unused]] const std::chrono::nanoseconds previous)
+    {
+#if defined(STE_TIMER_STATS)
+        const auto start = clock_t::now();
+#endif
+
+#if defined(STE_TIMER_TRACE)
+        const auto begin = trace::now();
+#endif
+
+        using result_t = detail::call_result_t<function_t>;
+
+        next_call next;
+
+        if constexpr(std::is_void_v<result_t>)
+        {
+            _function.read([](function_t& f) { f(); });
+        }
+        else if constexpr(std::is_same_v<result_t, bool>)
+        {
+            next.stop = !_function.read([](function_t& f) { return f(); });
+        }
+        else
+        {
+            const auto delay = std::chrono::duration_cast<typename clock_t::duration>(_function.read([previous](function_t& f)
+            {
+                if constexpr(detail::takes_previous_v<function_t>)
+                {
+                    return f(previous);
+                }
+                else
+                {
+                    return f();
+                }
+            }));
+            next.delay       = std::max(delay, clock_t::duration::zero());
+        }
+
+#if defined(STE_TIMER_TRACE)
+        trace::record(trace::event_type::fire, this, trace::now() - begin, lateness, begin);
+#endif
+
+#if defined(STE_TIMER_STATS)
+        _stats.record_duration(clock_t::now() - start);
+#endif
+
+        return next;
+    }
+
+    /// Waits until no call submitted to the executor is in progress.
+    inline void wait_idle()
+    {
+        std::unique_lock lock(_wait_mutex);
+        _wait_cv.wait(lock, [this]() { return _in_flight == 0; });
+    }
+
+    /// Sets _stopped and wakes the worker. Returns the previous value.
+    inline bool set_stopped(const bool stopped)
+    {
+        bool previous;
+
+        {
+            std::lock_guard lock(_wait_mutex);
+            previous = _stopped.exchange(stopped);
+        }
+
+        _wait_cv.notify_all();
+
+        return previous;
+    }
+
+    /// Stops the timer after its last call (single shot, function returning false). Requires the lock of the mode.
+    inline void stop_after_call()
+    {
+        // Only the thread that changes the state records it, whatever stop() does concurrently.
+        const bool was_stopped = _stopped.exchange(true);
+
+#if defined(STE_TIMER_TRACE)
+        if(!was_stopped)
+        {
+            trace::record(trace::event_type::stop, this);
+        }
+#else
+        static_cast<void>(was_stopped);
+#endif
+    }
+
+    /// Service of timers that are not given one: clock_t::service() if it exists, none otherwise.
+    static inline service_type* default_service()
+    {
+        if constexpr(detail::has_service_v<clock_t>)
+        {
+            return &clock_t::service();
+        }
+        else
+        {
+            return nullptr;
+        }
+    }
+
+    /// Offset of the first call of a run, according to the phase mode (see set_phase()).
+    inline typename clock_t::duration phase_offset() const
+    {
+        using clock_duration = typename clock_t::duration;
+
+        const auto mode = _phase_mode.load(std::memory_order_relaxed);
+
+        if(mode == ste::phase_mode::none)
+        {
+            return clock_duration::zero();
+        }
+
+        const auto bound = _phase_bound.load(std::memory_order_relaxed);
+        const auto span  = std::chrono::duration_cast<clock_duration>(bound > std::chrono::nanoseconds::zero() ? bound : std::chrono::duration_cast<std::chrono::nanoseconds>(interval()));
+
+        double fraction = 0;
+
+        switch(mode)
+        {
+            case ste::phase_mode::random:
+                fraction = detail::unit_interval(detail::random_u64());
+                break;
+
+            case ste::phase_mode::hashed:
+                fraction = detail::unit_interval(detail::mix(_phase_key.load(std::memory_order_relaxed)));
+                break;
+
+            default:
+                // Weyl sequence of the golden ratio: each new phase falls in the largest gap left by the previous ones.
+                fraction = detail::unit_interval(detail::spread_sequence.fetch_add(1, std::memory_order_relaxed) * 0x9E3779B97F4A7C15u);
+                break;
+        }
+
+        return clock_duration(static_cast<typename clock_duration::rep>(static_cast<double>(span.count()) * fraction));
+    }
+
+    /// Random offset of the next deadline from the schedule, in [-jitter / 2, jitter / 2) (see set_tick_jitter()).
+    inline typename clock_t::duration tick_offset() const
+    {
+        using clock_duration = typename clock_t::duration;
+
+        const auto jitter = std::min(_tick_jitter.load(std::memory_order_relaxed),
+                                     std::chrono::duration_cast<std::chrono::nanoseconds>(interval()));
+
+        if(jitter <= std::chrono::nanoseconds::zero())
+        {
+            return clock_duration::zero();
+        }
+
+        const auto span = std::chrono::duration_cast<clock_duration>(jitter);
+
+        return clock_duration(static_cast<typename clock_duration::rep>(static_cast<double>(span.count()) * (detail::unit_interval(detail::random_u64()) - 0.5)));
+    }
+
+    /// Terminates and joins the worker, if any. The timer must be stopped.
+    inline void retire_worker()
+    {
+        {
+            std::lock_guard lock(_wait_mutex);
+            _exiting = true;
+        }
+
+        _wait_cv.notify_all();
+
+        if(_thread.joinable())
+        {
+            _thread.join();
+        }
+
+        std::lock_guard lock(_wait_mutex);
+        _exiting = false;
+    }
+
+    /// Returns 'true' if the loop started at 'run_epoch' must return. Requires _wait_mutex.
+    inline bool interrupted(const std::uint64_t run_epoch) const
+    {
+        return _stopped || _run_epoch != run_epoch;
+    }
+
+    /// Makes the pending wait (thread or service) use the current interval and delay.
+    inline void reconfigure()
+    {
+        if(_service != nullptr)
+        {
+            std::lock_guard lock(_service_mutex);
+
+            // Fails harmlessly if the expiration is running: it is re-armed with the new values.
+            if(_service_id != 0)
+            {
+                const auto deadline = service_deadline();
+
+                if(_service->reschedule(_service_id, deadline))
+                {
+                    _service_deadline = deadline;
+                }
+            }
+
+            return;
+        }
+
+        {
+            std::lock_guard lock(_wait_mutex);
+            ++_config_epoch;
+        }
+
+        _wait_cv.notify_all();
+    }
+
+    /**
+     *  @brief  Waits until 'base' + offset(). The deadline is recomputed if the timer is reconfigured.
+     *  @return The deadline that was reached, or std::nullopt if the timer was stopped or restarted.
+     */
+    template<typename offset_f>
+    inline std::optional<time_point> wait_from(const std::uint64_t run_epoch,
+                                               const time_point base,
+                                               const offset_f offset)
+    {
+        apply_slack();
+
+        std::unique_lock lock(_wait_mutex);
+
+        for(;;)
+        {
+            const auto epoch    = _config_epoch.load();
+            const auto deadline = base + std::chrono::duration_cast<typename clock_t::duration>(offset());
+            const auto spin     = std::chrono::duration_cast<typename clock_t::duration>(spin_threshold());
+
+            const bool woken = _wait_cv.wait_until(lock, deadline - spin, [&]() { return interrupted(run_epoch) || _config_epoch != epoch; });
+
+            if(!woken && spin.count() != 0)
+            {
+                lock.unlock();
+                spin_until(deadline, run_epoch, epoch);
+                lock.lock();
+            }
+
+            if(interrupted(run_epoch))
+            {
+                return std::nullopt;
+            }
+
+            if(_config_epoch == epoch)
+            {
+                return deadline;
+            }
+        }
+    }
+
+    /// Makes slack() the kernel timer slack of the worker. Worker only.
+    inline void apply_slack()
+    {
+#if defined(__linux__)
+        const auto slack = _slack.load(std::memory_order_relaxed);
+
+        if(slack != _applied_slack)
+        {
+            // 0 restores the default slack of the thread.
+            ::prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(slack.count()), 0, 0, 0);
+            _applied_slack = slack;
+        }
+#endif
+    }
+
+    /// Busy-waits until 'deadline', or until the timer is stopped, restarted or reconfigured.
+    inline void spin_until(const time_point deadline,
+                           const std::uint64_t run_epoch,
+                           const std::uint64_t config_epoch) const
+    {
+        while(clock_t::now() < deadline)
+        {
+            if(_stopped.load(std::memory_order_relaxed)             ||
+               _run_epoch.load(std::memory_order_relaxed) != run_epoch ||
+               _config_epoch.load(std::memory_order_relaxed) != config_epoch)
+            {
+                return;
+            }
+
+            detail::cpu_relax();
+        }
+    }
+
+    /// Main loop of the worker: parks while the timer is stopped, runs the call loop otherwise.
+    inline void run()
+    {
+        std::unique_lock lock(_wait_mutex);
+
+        for(;;)
+        {
+            _wait_cv.wait(lock, [this]() { return _exiting || !_stopped; });
+
+            if(_exiting)
+            {
+                return;
+            }
+
+            const auto run_epoch = _run_epoch.load();
+
+            lock.unlock();
+            call_loop(run_epoch);
+            lock.lock();
+        }
+    }
+
+    /// Call loop of the worker, for the run started at 'run_epoch'.
+    inline void call_loop(const std::uint64_t run_epoch)
+    {
+        const auto first = wait_from(run_epoch, clock_t::now() + phase_offset(), [this]() { return _delay.load(std::memory_order_relaxed); });
+
+        if(!first)
+        {
+            return;
+        }
+
+        // Start of the absolute schedule: deadline k is *first + k * interval.
+        auto base = *first;
+
+        // Interval returned by the last call, if any. Replaces interval() for the next tick.
+        std::optional<typename clock_t::duration> returned;
+
+        do
+        {
+            const auto jitter   = tick_offset();
+            const auto deadline = wait_from(run_epoch, base, [this, jitter, &returned]() { return next_interval(returned) + jitter; });
+
+            if(!deadline)
+            {
+                return;
+            }
+
+            const next_call next = call(*deadline, std::chrono::duration_cast<std::chrono::nanoseconds>(returned.value_or(clock_t::duration::zero())));
+
+            if(next.stop)
+            {
+                break;
+            }
+
+            returned = next.delay;
+
+            // From the unjittered deadline, so that the offsets do not accumulate.
+            base = next_base(*deadline - jitter, next_interval(returned));
+        }
+        while(!_single_shot.load(std::memory_order_relaxed)); //Also return if set to single shot mode while in the loop
+
+        std::lock_guard lock(_wait_mutex);
+
+        // Unless the function restarted the timer.
+        if(_run_epoch == run_epoch)
+        {
+            stop_after_call();
+        }
+    }
+
+    /**
+     *  @brief Returns the time the next deadline is computed from (deadline = base + interval),
+     *         applying the period mode and the overrun policy.
+     *  @param last Deadline of the call that just returned.
+     *  @param period Interval before the next deadline.
+     */
+    inline time_point next_base(const time_point last,
+                                const typename clock_t::duration period)
+    {
+        const auto now = clock_t::now();
+        const auto mode = _period_mode.load(std::memory_order_relaxed);
+
+        if(mode == ste::period_mode::relative)
+        {
+            return now;
+        }
+
+        if(period.count() <= 0 || now < last + period)
+        {
+            return last;
+        }
+
+        // Number of deadlines already passed.
+        const auto passed = static_cast<std::uint64_t>((now - last - period) / period) + 1;
+
+#if defined(STE_TIMER_TRACE)
+        trace::record(trace::event_type::overrun, this, passed);
+#endif
+
+#if defined(STE_TIMER_STATS)
+        _stats.record_overrun();
+
+        if(mode != ste::period_mode::catch_up)
+        {
+            _stats.record_skips(passed);
+        }
+#endif
+
+        switch(mode)
+        {
+            case ste::period_mode::catch_up:
+                ++_missed_ticks; // Fired late, one at a time.
+                return last;
+
+            case ste::period_mode::skip:
+                _missed_ticks += passed;
+                return last + period * passed;
+
+            case ste::period_mode::reanchor:
+            default:
+                _missed_ticks += passed;
+                return now;
+        }
+    }
+
+    /// Interval before the next tick: 'returned' by the function, or interval().
+    inline typename clock_t::duration next_interval(const std::optional<typename clock_t::duration>& returned) const
+    {
+        return returned ? *returned : std::chrono::duration_cast<typename clock_t::duration>(_interval.load(std::memory_order_relaxed));
+    }
+
+    /// Deadline of the next service expiration. Requires _service_mutex.
+    inline time_point service_deadline() const
+    {
+        using clock_duration = typename clock_t::duration;
+
+        const auto offset = next_interval(_service_delay) +
+                            (_service_first ? std::chrono::duration_cast<clock_duration>(delay()) : clock_duration::zero());
+
+        return _service_base + offset + _service_jitter;
+    }
+
+    /// Expiration handler used when the timer is registered with a service.
+    inline void on_service_tick()
+    {
+        if(_stopped)
+        {
+            return;
+        }
+
+        time_point deadline;
+        typename service_type::id current;
+        std::chrono::nanoseconds previous;
+
+        {
+            std::lock_guard lock(_service_mutex);
+            deadline = _service_deadline;
+            current  = _service_id;
+            previous = std::chrono::duration_cast<std::chrono::nanoseconds>(_service_delay.value_or(clock_t::duration::zero()));
+        }
+
+        const next_call next = call(deadline, previous);
+
+        std::lock_guard lock(_service_mutex);
+
+        // stop() cleared the expiration, or the function restarted the timer, which armed a new one.
+        if(_service_id != current)
+        {
+            return;
+        }
+
+        if(_stopped || _single_shot || next.stop)
+        {
+            stop_after_call();
+            _service_id = 0;
+            return;
+        }
+
+        _service_delay    = next.delay;
+        _service_base     = next_base(deadline - _service_jitter, next_interval(_service_delay));
+        _service_first    = false;
+        _service_jitter   = tick_offset();
+        _service_deadline = service_deadline();
+
+        if constexpr(detail::has_service_v<clock_t>)
+        {
+            // A zero interval, set or returned since start(), would re-arm at the same simulated time forever.
+            _service_deadline = std::max(_service_deadline, deadline + typename clock_t::duration(1));
+        }
+
+        _service_id = _service->schedule_at(_service_deadline, [this]() { on_service_tick(); }, slack());
+    }
+
+public:
+
+    /*********************************************************************/
+    /*                            Operators                              */
+    /*********************************************************************/
+
+    inline friend std::ostream& operator<<(std::ostream& out, const timer& t)
+    {
+        out << "ste::timer:\n"
+            << "    Interval: " << t.interval().count() << detail::duration_unit<interval_t>() << "\n"
+            << "    Delay: " << t.delay().count() << detail::duration_unit<delay_t>() << "\n"
+            << "    Single-shot: " << t.single_shot();
+
+#if defined(STE_TIMER_STATS)
+        out << "\n    Stats: " << t.stats();
+#endif
 
-        return out << "ste::timer:\n"
-                   << "    Interval: " << t.interval().count() << interval_unit << "\n"
-                   << "    Delay: " << t.delay().count() << delay_unit << "\n"
-                   << "    Single-shot: " << t.single_shot();
+        return out;
     }
 };
 
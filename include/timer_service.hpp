@@ -0,0 +1,1176 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_timer_service_HPP
+#define STE_timer_service_HPP
+
+#include "inplace_function.hpp"
+
+#include "thread_attributes.hpp"
+
+#if defined(STE_TIMER_STATS)
+#include "timer_stats.hpp"
+#endif
+
+#include <algorithm>
+
+#include <chrono>
+
+#include <condition_variable>
+
+#include <cstdint>
+
+#include <limits>
+
+#include <mutex>
+
+#include <stdexcept>
+
+#include <system_error>
+
+#include <thread>
+
+#include <type_traits>
+
+#include <utility>
+
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+
+#include <sched.h>
+
+#include <sys/timerfd.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace ste
+{
+
+namespace detail
+{
+
+/// 'true' if 'clock_t' drives its own service through a static 'service()' (e.g. ste::manual_clock).
+template<typename clock_t, typename = void>
+struct has_service : std::false_type {};
+
+template<typename clock_t>
+struct has_service<clock_t, std::void_t<decltype(clock_t::service())>> : std::true_type {};
+
+template<typename clock_t>
+inline constexpr bool has_service_v = has_service<clock_t>::value;
+
+} //namespace detail
+
+/**
+                                ste::basic_timer_service
+
+    @short Runs any number of timers from one (or a few) dispatcher threads.
+
+    @details
+    Features:
+        • All pending expirations are kept in a single indexed min-heap ordered by deadline.
+          Expirations with the same deadline run in the order they were scheduled.
+        • Callbacks run on the dispatcher threads, outside of the internal lock,
+          so they may freely schedule or cancel other expirations.
+        • Callbacks are ste::inplace_function objects stored in one contiguous array:
+          once reserve() has been called, scheduling does not allocate.
+        • One-shot and periodic expirations. Periodic expirations skip the ticks
+          they missed instead of firing them in a burst.
+        • Optional per-expiration slack: an expiration may run anywhere between its deadline
+          and its deadline + slack. The dispatchers sleep until the earliest deadline + slack,
+          then run every expiration whose window has opened, so that overlapping windows
+          share one wakeup (see coalesced_wakeups()).
+        • cancel() waits for a running callback to return (unless it is called from that
+          callback, or waiting would deadlock), so the callback never outlives a successful cancel().
+        • Timeouts (schedule_timeout()): one-shot expirations meant to be cancelled before they
+          fire. Their cancel() never waits for a callback nor allocates, and is safe from any
+          thread: under the service lock, it invalidates the slot in O(1) and leaves the heap
+          node in place. Stale nodes are popped when they reach the top of the heap, or all
+          removed in O(n) once they make up half of it, i.e. O(log n) amortized per cancel().
+        • With 0 threads, the service is driven by the host's event loop instead: on Linux,
+          fd() is a timerfd armed to the earliest deadline, to be polled with epoll / poll /
+          select, and dispatch_ready() runs the due callbacks on the calling thread.
+        • Optional lateness / duration histograms of all callbacks, compiled in only if
+          STE_TIMER_STATS is defined (see stats()).
+        • 'clock_t' is std::chrono::steady_clock (ste::timer_service), std::chrono::system_clock,
+          or a simulated clock such as ste::manual_clock. Simulated clocks require 0 threads,
+          and have no fd(): the service is driven by the clock itself (see ste::manual_clock).
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename clock_t>
+class basic_timer_service
+{
+public:
+
+    using clock      = clock_t;
+    using duration   = typename clock::duration;
+    using time_point = typename clock::time_point;
+    using callback_t = inplace_function<void(void)>;
+
+    /// Identifies a scheduled expiration. 0 is never a valid id.
+    using id = std::uint64_t;
+
+    /// Identifies a timeout (see schedule_timeout()). Stale handles are harmless.
+    struct timeout_handle
+    {
+        std::uint64_t value = 0; ///< Generation << 32 | slot. 0 is never valid.
+
+        inline explicit operator bool() const noexcept { return value != 0; }
+
+        inline friend bool operator==(const timeout_handle a, const timeout_handle b) noexcept { return a.value == b.value; }
+        inline friend bool operator!=(const timeout_handle a, const timeout_handle b) noexcept { return a.value != b.value; }
+    };
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// Storage for one scheduled expiration. Slots are recycled through _free.
+    struct entry
+    {
+        time_point deadline   = {};
+        duration period       = {};     ///< Zero for one-shot expirations.
+        duration slack        = {};     ///< May run up to this long after deadline. The heap is ordered by deadline + slack.
+        std::uint64_t sequence = 0;     ///< Queuing order, breaks ties between equal deadlines.
+        callback_t callback   = {};
+        std::size_t heap_index = npos;  ///< Position in _heap, npos if not queued.
+        std::uint32_t generation = 1;   ///< Incremented each time the slot is released.
+        bool running   = false;         ///< Callback currently executing on a dispatcher.
+        bool cancelled = false;         ///< cancel() was called while running.
+        std::thread::id runner = {};    ///< Dispatcher executing the callback, while running.
+    };
+
+    /// Marks the end of the list of free timeout slots.
+    static constexpr std::uint32_t no_slot = std::numeric_limits<std::uint32_t>::max();
+
+    /// Storage for one timeout. Free slots are linked through 'next_free', from _free_timeout.
+    struct timeout_slot
+    {
+        callback_t callback      = {};
+        std::uint32_t generation = 1;       ///< Incremented each time the timeout fires or is cancelled.
+        std::uint32_t next_free  = no_slot; ///< Next free slot, while this one is free.
+    };
+
+    /// Element of _timeout_heap. Stale once the generation of its slot changed.
+    struct timeout_node
+    {
+        time_point deadline;
+        std::uint64_t sequence;
+        std::uint32_t index;
+        std::uint32_t generation;
+    };
+
+    /// Protects every attribute below.
+    mutable std::mutex _mutex;
+
+    /// Wakes the dispatchers when the earliest deadline changes or on exit.
+    std::condition_variable _wake;
+
+    /// Wakes cancel() callers waiting for a running callback to return.
+    std::condition_variable _finished;
+
+    /// Threads blocked in cancel(), and the expiration each one waits for. Avoids needless notifications.
+    std::vector<std::pair<std::thread::id, id>> _cancel_waits;
+
+    /// Entries, indexed by the lower 32 bits of their id.
+    std::vector<entry> _entries;
+
+    /// Released slots of _entries.
+    std::vector<std::uint32_t> _free;
+
+    /// Min-heap of indices into _entries, ordered by deadline.
+    std::vector<std::uint32_t> _heap;
+
+    /// Timeouts, indexed by the lower 32 bits of their handle.
+    std::vector<timeout_slot> _timeouts;
+
+    /// First free slot of _timeouts. Releasing a slot links it in place: never allocates.
+    std::uint32_t _free_timeout = no_slot;
+
+    /// Number of free slots of _timeouts.
+    std::size_t _free_timeout_count = 0;
+
+    /// Min-heap of timeouts, ordered by deadline. May contain stale nodes, but never on top.
+    std::vector<timeout_node> _timeout_heap;
+
+    /// Incremented each time an expiration or a timeout is queued.
+    std::uint64_t _sequence = 0;
+
+    /// Number of stale nodes in _timeout_heap.
+    std::size_t _stale_timeouts = 0;
+
+    /// Number of callbacks run before their deadline + slack, in the wakeup of another one.
+    std::uint64_t _coalesced = 0;
+
+    /// Time by which a sleeping dispatcher (or fd()) wakes up anyway. Only earlier deadlines
+    /// need a notification: arming many timeouts for the same delay does not wake anyone.
+    time_point _wake_deadline = time_point::max();
+
+    /// Set by the destructor to stop the dispatchers.
+    bool _exiting = false;
+
+#if defined(STE_TIMER_STATS)
+    /// Lateness and duration histograms of all callbacks (see stats()).
+    timer_stats _stats;
+#endif
+
+    /// Dispatcher threads. Empty if the service is driven by the host (see dispatch_ready()).
+    std::vector<attributed_thread> _threads;
+
+    /// What could not be applied to the dispatcher threads (see thread_status()).
+    thread_attributes_status _thread_status;
+
+    /// Thread inside dispatch_ready(), if any.
+    std::thread::id _host_dispatcher;
+
+#if defined(__linux__)
+    /// timerfd armed to the earliest deadline when the service has no threads, -1 otherwise.
+    int _fd = -1;
+#endif
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param threads (optional) Number of dispatcher threads. Default is 1.
+     *                            With 0, callbacks only run from dispatch_ready().
+     *  @throw std::system_error if the timerfd of a 0-thread service cannot be created.
+     *  @throw std::invalid_argument if 'threads' is not 0 with a simulated clock.
+     */
+    inline explicit basic_timer_service(const std::size_t threads = 1)
+        : basic_timer_service(threads, thread_attributes())
+    {}
+
+    /**
+     *  @brief Constructor.
+     *  @param threads Number of dispatcher threads. With 0, callbacks only run from dispatch_ready().
+     *  @param attributes Scheduling, affinity, stack size and name of the dispatcher threads.
+     *                    What cannot be applied is skipped and reported by thread_status().
+     *  @throw std::system_error if the timerfd of a 0-thread service, or a thread, cannot be created.
+     *  @throw std::invalid_argument if 'threads' is not 0 with a simulated clock (one that drives
+     *         its own service, such as ste::manual_clock): its time only moves when it is told to.
+     */
+    inline basic_timer_service(const std::size_t threads, const thread_attributes& attributes)
+    {
+        if(detail::has_service_v<clock> && threads != 0)
+        {
+            throw std::invalid_argument("ste::timer_service: a simulated clock requires 0 dispatcher threads");
+        }
+
+#if defined(__linux__)
+        constexpr bool steady   = std::is_same_v<clock, std::chrono::steady_clock>;
+        constexpr bool realtime = std::is_same_v<clock, std::chrono::system_clock>;
+
+        if(threads == 0 && (steady || realtime))
+        {
+            _fd = ::timerfd_create(steady ? CLOCK_MONOTONIC : CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+
+            if(_fd < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "ste::timer_service: timerfd_create");
+            }
+        }
+#endif
+
+        _threads.reserve(threads);
+
+        for(std::size_t i = 0; i < threads; ++i)
+        {
+            _threads.emplace_back(attributes, [this]() { dispatch(); });
+            _thread_status |= _threads.back().status();
+        }
+    }
+
+    /// Destructor. Pending expirations are dropped, running callbacks are waited for.
+    inline ~basic_timer_service()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _exiting = true;
+        }
+
+        _wake.notify_all();
+
+        for(auto& t : _threads)
+        {
+            t.join();
+        }
+
+#if defined(__linux__)
+        if(_fd >= 0)
+        {
+            ::close(_fd);
+        }
+#endif
+    }
+
+    basic_timer_service(const basic_timer_service&)            = delete;
+    basic_timer_service(basic_timer_service&&)                 = delete;
+    basic_timer_service& operator=(const basic_timer_service&) = delete;
+    basic_timer_service& operator=(basic_timer_service&&)      = delete;
+
+    /*********************************************************************/
+    /*                             Scheduling                            */
+    /*********************************************************************/
+
+    /// Calls 'callback' once at 'deadline', or up to 'slack' later.
+    inline id schedule_at(const time_point deadline, callback_t callback, const duration slack = duration::zero())
+    {
+        return insert(deadline, duration::zero(), std::move(callback), slack);
+    }
+
+    /// Calls 'callback' once after 'delay', or up to 'slack' later.
+    inline id schedule_after(const duration delay, callback_t callback, const duration slack = duration::zero())
+    {
+        return insert(clock::now() + delay, duration::zero(), std::move(callback), slack);
+    }
+
+    /**
+     *  @brief Calls 'callback' after 'delay', then every 'period' until cancelled.
+     *         Each call may happen up to 'slack' after its deadline.
+     *  @note  A zero period schedules a single call.
+     */
+    inline id schedule_every(const duration delay, const duration period, callback_t callback, const duration slack = duration::zero())
+    {
+        return insert(clock::now() + delay, period, std::move(callback), slack);
+    }
+
+    /**
+     *  @brief  Cancels an expiration.
+     *  @return 'true' if at least one future call was prevented, 'false' if
+     *          'i' is unknown, already fired or already cancelled.
+     *  @note   If the callback is running, waits for it to return unless called from
+     *          that callback, or from a callback it is itself waiting for (directly or
+     *          through other cancel() calls): these return without waiting.
+     */
+    inline bool cancel(const id i)
+    {
+        std::unique_lock lock(_mutex);
+
+        entry* const e = find(i);
+
+        if(e == nullptr || e->cancelled)
+        {
+            return false;
+        }
+
+        if(!e->running)
+        {
+            heap_erase(e->heap_index);
+            release(index_of(i));
+            return true;
+        }
+
+        e->cancelled = true;
+        const bool prevented = e->period != duration::zero();
+
+        if(!waits_for_current_thread(i))
+        {
+            _cancel_waits.emplace_back(std::this_thread::get_id(), i);
+
+            _finished.wait(lock, [&]() { return find(i) == nullptr; });
+
+            _cancel_waits.erase(std::find(_cancel_waits.begin(), _cancel_waits.end(), std::make_pair(std::this_thread::get_id(), i)));
+        }
+
+        return prevented;
+    }
+
+    /**
+     *  @brief Calls 'callback' once after 'delay', unless cancel() is called first.
+     *  @note  Cheaper than schedule_after() when most calls are cancelled: cancel(timeout_handle)
+     *         does not touch the heap, the dispatchers drop cancelled timeouts when they reach them.
+     *         May allocate when the slot array or the heap grows (see reserve()).
+     */
+    inline timeout_handle schedule_timeout(const duration delay, callback_t callback)
+    {
+        const time_point deadline = clock::now() + delay;
+
+        std::unique_lock lock(_mutex);
+
+        std::uint32_t index;
+
+        if(_free_timeout != no_slot)
+        {
+            index         = _free_timeout;
+            _free_timeout = _timeouts[index].next_free;
+            --_free_timeout_count;
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(_timeouts.size());
+            _timeouts.emplace_back();
+        }
+
+        timeout_slot& slot = _timeouts[index];
+        slot.callback = std::move(callback);
+
+        _timeout_heap.push_back({deadline, _sequence++, index, slot.generation});
+        std::push_heap(_timeout_heap.begin(), _timeout_heap.end(), timeout_later);
+
+        const timeout_handle result = {(static_cast<std::uint64_t>(slot.generation) << 32) | index};
+
+        if(deadline < _wake_deadline)
+        {
+            earliest_changed(lock);
+        }
+
+        return result;
+    }
+
+    /**
+     *  @brief  Cancels a timeout. Never waits for a callback, never allocates. Takes the service
+     *          lock: O(1), plus O(log n) amortized to drop the stale nodes that reach the top
+     *          of the timeout heap.
+     *  @return 'true' if the call was prevented, 'false' if 't' is stale: already
+     *          cancelled, or already fired (the callback may still be running).
+     */
+    inline bool cancel(const timeout_handle t)
+    {
+        const auto index = static_cast<std::uint32_t>(t.value & 0xFFFFFFFFu);
+
+        callback_t callback;
+
+        {
+            std::lock_guard lock(_mutex);
+
+            if(index >= _timeouts.size() || _timeouts[index].generation != static_cast<std::uint32_t>(t.value >> 32))
+            {
+                return false;
+            }
+
+            callback = std::move(_timeouts[index].callback);
+            release_timeout(index);
+
+            ++_stale_timeouts;
+            prune_timeouts();
+        }
+
+        return true; // 'callback' is destroyed outside of the lock.
+    }
+
+    /**
+     *  @brief  Moves the next expiration of 'i' to 'deadline'.
+     *  @return 'false' if 'i' is unknown, cancelled or currently running (never waits).
+     */
+    inline bool reschedule(const id i, const time_point deadline)
+    {
+        std::unique_lock lock(_mutex);
+
+        entry* const e = find(i);
+
+        if(e == nullptr || e->running)
+        {
+            return false;
+        }
+
+        e->deadline = deadline;
+        e->sequence = _sequence++;
+        sift_down(e->heap_index);
+        sift_up(e->heap_index);
+
+        if(deadline + e->slack < _wake_deadline)
+        {
+            earliest_changed(lock);
+        }
+
+        return true;
+    }
+
+    /*********************************************************************/
+    /*                      Host-driven dispatching                      */
+    /*********************************************************************/
+
+    /**
+     *  @brief  Runs every callback that is due, on the calling thread.
+     *  @return Number of callbacks run.
+     *  @note   Meant for 0-thread services, from the host's event loop when fd() is readable.
+     *          Callbacks may schedule and cancel expirations, including their own.
+     */
+    inline std::size_t dispatch_ready()
+    {
+#if defined(__linux__)
+        if(_fd >= 0)
+        {
+            std::uint64_t expirations = 0;
+            [[maybe_unused]] const auto r = ::read(_fd, &expirations, sizeof(expirations)); // Clears readiness.
+        }
+#endif
+
+        std::unique_lock lock(_mutex);
+
+        const auto previous = _host_dispatcher;
+        _host_dispatcher    = std::this_thread::get_id();
+
+        std::size_t count = 0;
+
+        while(run_due(lock))
+        {
+            ++count;
+        }
+
+        _host_dispatcher = previous;
+
+        arm_fd();
+
+        return count;
+    }
+
+#if defined(__linux__)
+    /**
+     *  @brief Returns the timerfd of a 0-thread service, -1 if the service has threads.
+     *  @note  Readable when dispatch_ready() has work. Owned by the service.
+     */
+    inline int fd() const
+    {
+        return _fd;
+    }
+#endif
+
+    /// Returns the time by which dispatch_ready() must run next (earliest deadline + slack),
+    /// time_point::max() if nothing is pending.
+    inline time_point next_deadline() const
+    {
+        std::lock_guard lock(_mutex);
+        return next_deadline_locked();
+    }
+
+    /// Returns the earliest time at which dispatch_ready() has a callback to run: the deadline,
+    /// without its slack, of the expiration or timeout that runs first. time_point::max() if none.
+    inline time_point next_due() const
+    {
+        std::lock_guard lock(_mutex);
+
+        const time_point entry   = _heap.empty() ? time_point::max() : _entries[_heap.front()].deadline;
+        const time_point timeout = _timeout_heap.empty() ? time_point::max() : _timeout_heap.front().deadline;
+
+        return std::min(entry, timeout);
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Preallocates room for 'capacity' simultaneous expirations, and as many timeouts.
+    inline void reserve(const std::size_t capacity)
+    {
+        std::lock_guard lock(_mutex);
+        _entries.reserve(capacity);
+        _free.reserve(capacity);
+        _heap.reserve(capacity);
+        _timeouts.reserve(capacity);
+        _timeout_heap.reserve(capacity);
+    }
+
+    /// Returns 'true' if 'i' is scheduled or running.
+    inline bool pending(const id i) const
+    {
+        std::lock_guard lock(_mutex);
+        const entry* const e = find(i);
+        return e != nullptr && !e->cancelled;
+    }
+
+    /// Returns 'true' if 't' has neither fired nor been cancelled.
+    inline bool pending(const timeout_handle t) const
+    {
+        const auto index = static_cast<std::uint32_t>(t.value & 0xFFFFFFFFu);
+
+        std::lock_guard lock(_mutex);
+        return index < _timeouts.size() && _timeouts[index].generation == static_cast<std::uint32_t>(t.value >> 32);
+    }
+
+    /// Returns the number of scheduled or running expirations, plus the number of pending timeouts.
+    inline std::size_t size() const
+    {
+        std::lock_guard lock(_mutex);
+        return _entries.size() - _free.size() + _timeouts.size() - _free_timeout_count;
+    }
+
+    /// Returns the number of dispatcher threads.
+    inline std::size_t thread_count() const
+    {
+        return _threads.size();
+    }
+
+    /// Returns what could not be applied to the dispatcher threads, if the service was created with ste::thread_attributes.
+    inline thread_attributes_status thread_status() const
+    {
+        return _thread_status;
+    }
+
+#if defined(__linux__)
+    /**
+     *  @brief  Pins the dispatcher threads to CPU 'cpu'.
+     *  @return 'false' if the service has no threads or the affinity could not be set.
+     */
+    inline bool set_affinity(const int cpu)
+    {
+        if(_threads.empty() || cpu < 0 || cpu >= CPU_SETSIZE)
+        {
+            return false;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        bool ok = true;
+
+        for(auto& t : _threads)
+        {
+            ok = ::pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0 && ok;
+        }
+
+        return ok;
+    }
+#endif
+
+    /// Returns the number of wakeups saved by slack: callbacks run early, in the wakeup of another one.
+    inline std::uint64_t coalesced_wakeups() const
+    {
+        std::lock_guard lock(_mutex);
+        return _coalesced;
+    }
+
+#if defined(STE_TIMER_STATS)
+    /// Returns the statistics of all callbacks since the service was created or reset_stats() was called.
+    inline timer_stats_snapshot stats() const
+    {
+        return _stats.snapshot();
+    }
+
+    /// Clears the statistics.
+    inline void reset_stats()
+    {
+        _stats.reset();
+    }
+#endif
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    static inline std::uint32_t index_of(const id i)
+    {
+        return static_cast<std::uint32_t>(i & 0xFFFFFFFFu);
+    }
+
+    inline id make_id(const std::uint32_t index) const
+    {
+        return (static_cast<id>(_entries[index].generation) << 32) | index;
+    }
+
+    /// Returns the live entry designated by 'i', nullptr if stale. Requires _mutex.
+    inline entry* find(const id i)
+    {
+        const auto index = index_of(i);
+
+        if(index >= _entries.size() || _entries[index].generation != static_cast<std::uint32_t>(i >> 32))
+        {
+            return nullptr;
+        }
+
+        entry& e = _entries[index];
+        return (e.running || e.heap_index != npos) ? &e : nullptr;
+    }
+
+    inline const entry* find(const id i) const
+    {
+        return const_cast<basic_timer_service*>(this)->find(i);
+    }
+
+    /**
+     *  @brief  Returns 'true' if the running callback of 'i' is, or waits for, the calling thread:
+     *          its runner is the calling thread, or is blocked in cancel() on an expiration whose
+     *          runner is, and so on. Requires _mutex.
+     */
+    inline bool waits_for_current_thread(id i) const
+    {
+        const auto current = std::this_thread::get_id();
+
+        // Each thread waits for one expiration at most: a chain longer than that loops elsewhere.
+        for(std::size_t hops = 0; hops <= _cancel_waits.size(); ++hops)
+        {
+            const entry* const e = find(i);
+
+            if(e == nullptr || !e->running)
+            {
+                return false;
+            }
+
+            if(e->runner == current)
+            {
+                return true;
+            }
+
+            const auto wait = std::find_if(_cancel_waits.begin(), _cancel_waits.end(), [&](const auto& w) { return w.first == e->runner; });
+
+            if(wait == _cancel_waits.end())
+            {
+                return false;
+            }
+
+            i = wait->second;
+        }
+
+        return false;
+    }
+
+    /// Notifies the dispatchers (or re-arms fd()) after a deadline earlier than _wake_deadline was queued. Unlocks 'lock'.
+    inline void earliest_changed(std::unique_lock<std::mutex>& lock)
+    {
+        if(_threads.empty())
+        {
+            // Re-armed once at the end of dispatch_ready() if it is running.
+            if(_host_dispatcher == std::thread::id())
+            {
+                arm_fd();
+            }
+
+            lock.unlock();
+        }
+        else
+        {
+            lock.unlock();
+            _wake.notify_one();
+        }
+    }
+
+    /// Arms fd() to the earliest deadline, or disarms it. Requires _mutex.
+    inline void arm_fd()
+    {
+#if defined(__linux__)
+        if(_fd < 0)
+        {
+            return;
+        }
+
+        itimerspec spec = {};
+
+        const auto deadline = next_deadline_locked();
+        _wake_deadline = deadline;
+
+        if(deadline != time_point::max())
+        {
+            // Monotonic times are never 0, which would disarm the timer: past deadlines fire immediately.
+            const auto since_epoch = deadline.time_since_epoch();
+            const auto seconds     = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+
+            spec.it_value.tv_sec  = static_cast<time_t>(std::max<std::int64_t>(seconds.count(), 0));
+            spec.it_value.tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - seconds).count());
+
+            if(spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec <= 0)
+            {
+                spec.it_value.tv_nsec = 1;
+            }
+        }
+
+        ::timerfd_settime(_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+#endif
+    }
+
+    inline id insert(const time_point deadline, const duration period, callback_t callback, const duration slack)
+    {
+        std::unique_lock lock(_mutex);
+
+        std::uint32_t index;
+
+        if(!_free.empty())
+        {
+            index = _free.back();
+            _free.pop_back();
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(_entries.size());
+            _entries.emplace_back();
+        }
+
+        entry& e   = _entries[index];
+        e.deadline = deadline;
+        e.period   = std::max(period, duration::zero());
+        e.slack    = std::max(slack, duration::zero());
+        e.callback = std::move(callback);
+
+        heap_push(index);
+
+        const id result = make_id(index);
+
+        if(deadline + e.slack < _wake_deadline)
+        {
+            earliest_changed(lock);
+        }
+
+        return result;
+    }
+
+    /// Makes a slot available again and invalidates its id. Requires _mutex.
+    inline void release(const std::uint32_t index)
+    {
+        entry& e     = _entries[index];
+        e.callback   = nullptr;
+        e.running    = false;
+        e.cancelled  = false;
+        e.runner     = {};
+        e.heap_index = npos;
+
+        // Generation 0 would let make_id() return 0.
+        if(++e.generation == 0)
+        {
+            e.generation = 1;
+        }
+
+        _free.push_back(index);
+    }
+
+    /// Main loop of the dispatcher threads.
+    inline void dispatch()
+    {
+        std::unique_lock lock(_mutex);
+
+        while(!_exiting)
+        {
+            const auto deadline = next_deadline_locked();
+
+            if(deadline == time_point::max())
+            {
+                _wake_deadline = deadline;
+                _wake.wait(lock);
+                _wake_deadline = time_point::max();
+                continue;
+            }
+
+            if(!run_due(lock))
+            {
+                // Another sleeping dispatcher may wake up earlier: this only causes extra notifications.
+                _wake_deadline = deadline;
+                _wake.wait_until(lock, deadline);
+                _wake_deadline = time_point::max();
+            }
+        }
+    }
+
+    /**
+     *  @brief  Runs the earliest expiration if it is due. Requires 'lock', which is released during the call.
+     *  @return 'false' if nothing was due.
+     */
+    inline bool run_due(std::unique_lock<std::mutex>& lock)
+    {
+        const auto now = clock::now();
+
+        const bool timeout_due = !_timeout_heap.empty() && _timeout_heap.front().deadline <= now;
+        const bool entry_due   = !_heap.empty() && _entries[_heap.front()].deadline <= now;
+
+        if(!timeout_due && !entry_due)
+        {
+            return false;
+        }
+
+        if(timeout_due && (!entry_due || _timeout_heap.front().deadline <= _entries[_heap.front()].deadline))
+        {
+            run_timeout(lock);
+            return true;
+        }
+
+        // The heap is ordered by deadline + slack: this runs the entries whose window has opened,
+        // in that order, until one has not (like Linux hrtimers).
+        const std::uint32_t index = _heap.front();
+        heap_erase(0);
+
+        entry& e = _entries[index];
+        e.running = true;
+        e.runner  = std::this_thread::get_id();
+
+        if(now < e.deadline + e.slack)
+        {
+            ++_coalesced;
+        }
+
+        callback_t callback = std::move(e.callback);
+
+#if defined(STE_TIMER_STATS)
+        const auto deadline = e.deadline;
+#endif
+
+        lock.unlock();
+
+#if defined(STE_TIMER_STATS)
+        const auto start = clock::now();
+        _stats.record_fire(start - deadline);
+#endif
+
+        callback();
+
+#if defined(STE_TIMER_STATS)
+        _stats.record_duration(clock::now() - start);
+#endif
+
+        lock.lock();
+
+        finish(index, std::move(callback));
+
+        return true;
+    }
+
+    /// Runs the earliest timeout. Requires 'lock', which is released during the call.
+    inline void run_timeout(std::unique_lock<std::mutex>& lock)
+    {
+        const timeout_node node = _timeout_heap.front();
+        std::pop_heap(_timeout_heap.begin(), _timeout_heap.end(), timeout_later);
+        _timeout_heap.pop_back();
+
+        // Released before the call: cancel() fails from now on, and the slot can be reused.
+        callback_t callback = std::move(_timeouts[node.index].callback);
+        release_timeout(node.index);
+        prune_timeouts();
+
+        lock.unlock();
+
+#if defined(STE_TIMER_STATS)
+        const auto start = clock::now();
+        _stats.record_fire(start - node.deadline);
+#endif
+
+        callback();
+
+#if defined(STE_TIMER_STATS)
+        _stats.record_duration(clock::now() - start);
+#endif
+
+        callback = nullptr;
+
+        lock.lock();
+    }
+
+    /// Re-queues or releases an entry whose callback just returned. Requires _mutex.
+    inline void finish(const std::uint32_t index, callback_t&& callback)
+    {
+        entry& e = _entries[index];
+
+        if(e.cancelled || e.period == duration::zero())
+        {
+            release(index);
+        }
+        else
+        {
+            e.running  = false;
+            e.runner   = {};
+            e.callback = std::move(callback);
+            e.deadline += e.period;
+
+            // Skip the ticks that were missed while the callback was running.
+            const auto now = clock::now();
+            if(e.deadline <= now)
+            {
+                const auto missed = (now - e.deadline) / e.period + 1;
+                e.deadline += e.period * missed;
+
+#if defined(STE_TIMER_STATS)
+                _stats.record_overrun();
+                _stats.record_skips(static_cast<std::uint64_t>(missed));
+#endif
+            }
+
+            heap_push(index);
+        }
+
+        if(!_cancel_waits.empty())
+        {
+            _finished.notify_all();
+        }
+    }
+
+    /// Returns the earliest deadline + slack among expirations and timeouts. Requires _mutex.
+    inline time_point next_deadline_locked() const
+    {
+        const time_point entry   = _heap.empty() ? time_point::max() : _entries[_heap.front()].deadline + _entries[_heap.front()].slack;
+        const time_point timeout = _timeout_heap.empty() ? time_point::max() : _timeout_heap.front().deadline;
+
+        return std::min(entry, timeout);
+    }
+
+    /// Makes a timeout slot available again and invalidates its handle. Requires _mutex.
+    inline void release_timeout(const std::uint32_t index)
+    {
+        timeout_slot& slot = _timeouts[index];
+
+        // Generation 0 would allow a handle of 0.
+        if(++slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+
+        slot.next_free = _free_timeout;
+        _free_timeout  = index;
+        ++_free_timeout_count;
+    }
+
+    /// Removes the stale nodes on top of _timeout_heap, or all of them if they dominate. Requires _mutex.
+    inline void prune_timeouts()
+    {
+        const auto stale = [this](const timeout_node& n) { return _timeouts[n.index].generation != n.generation; };
+
+        if(_stale_timeouts > 64 && _stale_timeouts * 2 > _timeout_heap.size())
+        {
+            _timeout_heap.erase(std::remove_if(_timeout_heap.begin(), _timeout_heap.end(), stale), _timeout_heap.end());
+            std::make_heap(_timeout_heap.begin(), _timeout_heap.end(), timeout_later);
+            _stale_timeouts = 0;
+            return;
+        }
+
+        while(!_timeout_heap.empty() && stale(_timeout_heap.front()))
+        {
+            std::pop_heap(_timeout_heap.begin(), _timeout_heap.end(), timeout_later);
+            _timeout_heap.pop_back();
+            --_stale_timeouts;
+        }
+    }
+
+    /// Orders _timeout_heap as a min-heap.
+    static inline bool timeout_later(const timeout_node& a, const timeout_node& b)
+    {
+        return a.deadline > b.deadline || (a.deadline == b.deadline && a.sequence > b.sequence);
+    }
+
+    /*********************************************************************/
+    /*                            Indexed heap                           */
+    /*********************************************************************/
+
+    inline bool heap_less(const std::size_t a, const std::size_t b) const
+    {
+        const entry& ea = _entries[_heap[a]];
+        const entry& eb = _entries[_heap[b]];
+
+        const time_point da = ea.deadline + ea.slack;
+        const time_point db = eb.deadline + eb.slack;
+
+        return da < db || (da == db && ea.sequence < eb.sequence);
+    }
+
+    inline void heap_swap(const std::size_t a, const std::size_t b)
+    {
+        std::swap(_heap[a], _heap[b]);
+        _entries[_heap[a]].heap_index = a;
+        _entries[_heap[b]].heap_index = b;
+    }
+
+    inline void sift_up(std::size_t i)
+    {
+        while(i != 0)
+        {
+            const std::size_t parent = (i - 1) / 2;
+
+            if(!heap_less(i, parent))
+            {
+                break;
+            }
+
+            heap_swap(i, parent);
+            i = parent;
+        }
+    }
+
+    inline void sift_down(std::size_t i)
+    {
+        for(;;)
+        {
+            const std::size_t left  = 2 * i + 1;
+            const std::size_t right = left + 1;
+            std::size_t smallest    = i;
+
+            if(left < _heap.size() && heap_less(left, smallest))
+            {
+                smallest = left;
+            }
+
+            if(right < _heap.size() && heap_less(right, smallest))
+            {
+                smallest = right;
+            }
+
+            if(smallest == i)
+            {
+                return;
+            }
+
+            heap_swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    inline void heap_push(const std::uint32_t index)
+    {
+        _heap.push_back(index);
+        _entries[index].heap_index = _heap.size() - 1;
+        _entries[index].sequence   = _sequence++;
+        sift_up(_heap.size() - 1);
+    }
+
+    inline void heap_erase(const std::size_t position)
+    {
+        _entries[_heap[position]].heap_index = npos;
+
+        const std::size_t last = _heap.size() - 1;
+
+        if(position != last)
+        {
+            _heap[position] = _heap[last];
+            _entries[_heap[position]].heap_index = position;
+            _heap.pop_back();
+            sift_down(position);
+            sift_up(position);
+        }
+        else
+        {
+            _heap.pop_back();
+        }
+    }
+};
+
+/// Timer service on std::chrono::steady_clock.
+using timer_service = basic_timer_service<std::chrono::steady_clock>;
+
+} //namespace ste
+#endif //STE_timer_service_HPP
@@ -0,0 +1,304 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_timer_stats_HPP
+#define STE_timer_stats_HPP
+
+#include <algorithm>
+
+#include <array>
+
+#include <atomic>
+
+#include <chrono>
+
+#include <cstddef>
+
+#include <cstdint>
+
+#include <ostream>
+
+namespace ste
+{
+
+/// Contents of a ste::histogram at some point in time.
+struct histogram_snapshot
+{
+    /// Each power of two is split in 'sub_buckets' linear buckets: relative error below 1/8.
+    static constexpr std::size_t sub_bits    = 3;
+    static constexpr std::size_t sub_buckets = std::size_t(1) << sub_bits;
+    static constexpr std::size_t buckets     = (64 - sub_bits + 1) * sub_buckets;
+
+    std::uint64_t count = 0;                        ///< Number of values recorded.
+    std::uint64_t sum   = 0;                        ///< Sum of the values.
+    std::uint64_t max   = 0;                        ///< Largest value.
+    std::array<std::uint64_t, buckets> counts = {}; ///< Number of values per bucket.
+
+    /// Returns the index of the bucket 'value' falls in.
+    static constexpr std::size_t bucket_of(const std::uint64_t value)
+    {
+        if(value < sub_buckets)
+        {
+            return static_cast<std::size_t>(value);
+        }
+
+        std::size_t msb = 0;
+        for(std::uint64_t v = value; v >>= 1;)
+        {
+            ++msb;
+        }
+
+        const std::size_t shift = msb - sub_bits;
+        return (shift + 1) * sub_buckets + static_cast<std::size_t>((value >> shift) & (sub_buckets - 1));
+    }
+
+    /// Returns the largest value that falls in bucket 'index'.
+    static constexpr std::uint64_t upper_bound_of(const std::size_t index)
+    {
+        if(index < sub_buckets)
+        {
+            return index;
+        }
+
+        const std::size_t shift = index / sub_buckets - 1;
+        const std::uint64_t low = (sub_buckets + index % sub_buckets) << shift;
+
+        return low + ((std::uint64_t(1) << shift) - 1);
+    }
+
+    /// Returns the mean of the values, 0 if there is none.
+    inline std::uint64_t mean() const
+    {
+        return count == 0 ? 0 : sum / count;
+    }
+
+    /// Returns an upper bound of the 'p'-th percentile (0 <= p <= 100), 0 if there is no value.
+    inline std::uint64_t percentile(const double p) const
+    {
+        const auto rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(count) + 0.5);
+        std::uint64_t seen = 0;
+
+        for(std::size_t i = 0; i < buckets; ++i)
+        {
+            seen += counts[i];
+
+            if(seen != 0 && seen >= rank)
+            {
+                return std::min(upper_bound_of(i), max);
+            }
+        }
+
+        return max;
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& out, const histogram_snapshot& h)
+    {
+        return out << "n=" << h.count
+                   << " mean=" << h.mean()
+                   << " p50=" << h.percentile(50)
+                   << " p99=" << h.percentile(99)
+                   << " max=" << h.max;
+    }
+};
+
+/**
+                                ste::histogram
+
+    @short Lock-free, fixed-size log-linear histogram of unsigned 64-bit values.
+
+    @details
+    Features:
+        • record() is wait-free (relaxed atomic increments), and never allocates.
+        • Values are bucketed with a relative error below 12.5%, from 0 to 2^64 - 1.
+        • snapshot() can be called concurrently with record(). It is not atomic as a whole:
+          values recorded meanwhile may be partially reflected.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class histogram
+{
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    std::array<std::atomic<std::uint64_t>, histogram_snapshot::buckets> _counts = {};
+
+    std::atomic<std::uint64_t> _count = 0;
+    std::atomic<std::uint64_t> _sum   = 0;
+    std::atomic<std::uint64_t> _max   = 0;
+
+public:
+
+    /*********************************************************************/
+    /*                             Recording                             */
+    /*********************************************************************/
+
+    /// Records 'value'.
+    inline void record(const std::uint64_t value)
+    {
+        _counts[histogram_snapshot::bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+
+        auto max = _max.load(std::memory_order_relaxed);
+        while(value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    /// Records a duration in nanoseconds. Negative durations are recorded as 0.
+    inline void record(const std::chrono::nanoseconds value)
+    {
+        record(static_cast<std::uint64_t>(std::max<std::int64_t>(value.count(), 0)));
+    }
+
+    /// Returns a copy of the current contents.
+    inline histogram_snapshot snapshot() const
+    {
+        histogram_snapshot s;
+
+        for(std::size_t i = 0; i < s.counts.size(); ++i)
+        {
+            s.counts[i] = _counts[i].load(std::memory_order_relaxed);
+        }
+
+        s.count = _count.load(std::memory_order_relaxed);
+        s.sum   = _sum.load(std::memory_order_relaxed);
+        s.max   = _max.load(std::memory_order_relaxed);
+
+        return s;
+    }
+
+    /// Clears the histogram.
+    inline void reset()
+    {
+        for(auto& c : _counts)
+        {
+            c.store(0, std::memory_order_relaxed);
+        }
+
+        _count.store(0, std::memory_order_relaxed);
+        _sum.store(0, std::memory_order_relaxed);
+        _max.store(0, std::memory_order_relaxed);
+    }
+};
+
+/// Contents of a ste::timer_stats at some point in time. Durations are in nanoseconds.
+struct timer_stats_snapshot
+{
+    std::uint64_t fires    = 0; ///< Number of calls.
+    std::uint64_t skips    = 0; ///< Number of ticks dropped without a call.
+    std::uint64_t overruns = 0; ///< Number of calls that returned after the next deadline.
+    histogram_snapshot lateness;    ///< Time between each deadline and the actual call.
+    histogram_snapshot duration;    ///< Duration of the calls.
+
+    inline friend std::ostream& operator<<(std::ostream& out, const timer_stats_snapshot& s)
+    {
+        return out << "fires=" << s.fires << " skips=" << s.skips << " overruns=" << s.overruns << "\n"
+                   << "    Lateness (ns): " << s.lateness << "\n"
+                   << "    Duration (ns): " << s.duration;
+    }
+};
+
+/**
+                                ste::timer_stats
+
+    @short Fire lateness and call duration histograms, plus fire / skip / overrun counters.
+
+    @details
+    Recorded by ste::timer and ste::timer_service when STE_TIMER_STATS is defined
+    (CMake option STE_TIMER_STATS). Otherwise, neither contains nor updates any statistic.
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+class timer_stats
+{
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    histogram _lateness;
+    histogram _duration;
+
+    std::atomic<std::uint64_t> _fires    = 0;
+    std::atomic<std::uint64_t> _skips    = 0;
+    std::atomic<std::uint64_t> _overruns = 0;
+
+public:
+
+    /*********************************************************************/
+    /*                             Recording                             */
+    /*********************************************************************/
+
+    /// Records a call made 'lateness' after its deadline.
+    inline void record_fire(const std::chrono::nanoseconds lateness)
+    {
+        _fires.fetch_add(1, std::memory_order_relaxed);
+        _lateness.record(lateness);
+    }
+
+    /// Records a call that lasted 'duration'.
+    inline void record_duration(const std::chrono::nanoseconds duration)
+    {
+        _duration.record(duration);
+    }
+
+    /// Records 'count' ticks dropped without a call.
+    inline void record_skips(const std::uint64_t count)
+    {
+        _skips.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /// Records a call that returned after the next deadline.
+    inline void record_overrun()
+    {
+        _overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Returns a copy of the current statistics.
+    inline timer_stats_snapshot snapshot() const
+    {
+        return {_fires.load(std::memory_order_relaxed),
+                _skips.load(std::memory_order_relaxed),
+                _overruns.load(std::memory_order_relaxed),
+                _lateness.snapshot(),
+                _duration.snapshot()};
+    }
+
+    /// Clears the statistics.
+    inline void reset()
+    {
+        _lateness.reset();
+        _duration.reset();
+        _fires.store(0, std::memory_order_relaxed);
+        _skips.store(0, std::memory_order_relaxed);
+        _overruns.store(0, std::memory_order_relaxed);
+    }
+};
+
+} //namespace ste
+#endif //STE_timer_stats_HPP
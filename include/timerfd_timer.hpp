@@ -0,0 +1,467 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_timerfd_timer_HPP
+#define STE_timerfd_timer_HPP
+
+#if defined(__linux__)
+
+#include "rcu_cell.hpp"
+
+#include "timer.hpp"
+
+#include <sys/timerfd.h>
+
+#include <unistd.h>
+
+#include <atomic>
+
+#include <cerrno>
+
+#include <chrono>
+
+#include <cstdint>
+
+#include <ostream>
+
+#include <system_error>
+
+#include <type_traits>
+
+namespace ste
+{
+
+/**
+                                ste::timerfd_timer
+
+    @short Linux timer backed by a timerfd, dispatched by the host's event loop. Creates no thread.
+
+    @details
+    Features:
+        • Same interval / delay / single-shot / period mode semantics as ste::timer.
+        • fd() can be registered with epoll / poll / select. When it is readable,
+          dispatch_ready() calls the function on the calling thread.
+        • Continuous absolute modes are periodic in the kernel: they do not drift,
+          and overruns are detected from the timerfd expiration count.
+
+    To multiplex many timers on a single timerfd, register ste::timer objects with
+    a ste::timer_service constructed with 0 threads instead (see timer_service::fd()).
+
+     @author DUHAMEL Erwan (erwanduhamel@outlook.com)
+*/
+template<typename function_t, typename delay_t, typename interval_t>
+class timerfd_timer
+{
+    static_assert (std::is_invocable<function_t>::value, "ste::timerfd_timer can only be initialized with an invocable template parameter." );
+    static_assert (detail::is_duration_v<delay_t>, "ste::timerfd_timer delay must be a std::chrono::duration." );
+    static_assert (detail::is_duration_v<interval_t>, "ste::timerfd_timer interval must be a std::chrono::duration." );
+
+private:
+
+    /*********************************************************************/
+    /*                             Attributes                            */
+    /*********************************************************************/
+
+    /// The timerfd.
+    int _fd;
+
+    /// Current state of the timer.
+    std::atomic<bool> _stopped = true;
+
+    /// 'true' once the first expiration has been dispatched since start().
+    std::atomic<bool> _fired = false;
+
+    /// Timer mode (continuous calls to the function or single call after the delay)
+    std::atomic<bool> _single_shot;
+
+    /// Interval between two function calls.
+    std::atomic<interval_t> _interval;
+
+    /// Delay before the first call.
+    std::atomic<delay_t> _delay;
+
+    /// How deadlines are computed in continuous mode.
+    std::atomic<ste::period_mode> _period_mode = ste::period_mode::relative;
+
+    /// Number of ticks that were not fired on time (see missed_ticks()).
+    std::atomic<std::uint64_t> _missed_ticks = 0;
+
+    /// Function to call.
+    rcu_cell<function_t> _function;
+
+public:
+
+    /*********************************************************************/
+    /*             Construction / destruction / assignment               */
+    /*********************************************************************/
+
+    /**
+     *  @brief Constructor.
+     *  @param function Function to call.
+     *  @param interval Duration between calls.
+     *  @param delay (optional) Duration to wait before the timer starts its call loop. Default is {}.
+     *  @param single_shot (optional) Indicates if timer must execute its function
+     *                                until lifetime expires or stop() is called.
+     *                                Default is true.
+     *  @param start (optional) Indicates if the timer must be started immediately. Default is false.
+     *  @throw std::system_error if the timerfd cannot be created.
+     */
+    inline timerfd_timer(function_t function,
+                         const interval_t interval,
+                         const delay_t delay    = {},
+                         const bool single_shot = true,
+                         const bool start       = false)
+        :
+          _fd(::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+          _single_shot(single_shot),
+          _interval(interval),
+          _delay(delay),
+          _function(std::move(function))
+    {
+        if(_fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "ste::timerfd_timer: timerfd_create");
+        }
+
+        if(start)
+        {
+            this->start();
+        }
+    }
+
+    /**
+     *  @brief Constructor.
+     *  @param function Function to call.
+     *  @param interval Duration between calls.
+     *  @param delay (optional) Duration to wait before the timer starts its call loop. Default is 0.
+     *  @param single_shot (optional) Indicates if timer must execute its function
+     *                                until lifetime expires or stop() is called.
+     *                                Default is true.
+     *  @param start (optional) Indicates if the timer must be started immediately. Default is false.
+     *  @throw std::system_error if the timerfd cannot be created.
+     */
+    inline timerfd_timer(function_t function,
+                         const std::uint64_t interval,
+                         const std::uint64_t delay    = 0,
+                         const bool single_shot       = true,
+                         const bool start             = false)
+        : timerfd_timer(function,
+                        static_cast<interval_t>(interval),
+                        static_cast<delay_t>(delay),
+                        single_shot,
+                        start)
+    {}
+
+    /// Destructor. Closes the timerfd: remove it from the event loop first.
+    inline ~timerfd_timer()
+    {
+        ::close(_fd);
+    }
+
+    timerfd_timer(const timerfd_timer&)            = delete;
+    timerfd_timer(timerfd_timer&&)                 = delete;
+    timerfd_timer& operator=(const timerfd_timer&) = delete;
+    timerfd_timer& operator=(timerfd_timer&&)      = delete;
+
+    /*********************************************************************/
+    /*                         Timer management                          */
+    /*********************************************************************/
+
+    /// Starts the timer. Nothing happens if the timer is already started.
+    inline void start()
+    {
+        if(_stopped.exchange(false))
+        {
+            _fired = false;
+            arm_from_now();
+        }
+    }
+
+    /// Stops the timer. Expirations that were not dispatched yet are dropped.
+    inline void stop()
+    {
+        _stopped = true;
+        arm(std::chrono::nanoseconds::zero(), std::chrono::nanoseconds::zero());
+    }
+
+    /**
+     *  @brief  Calls the function for the expirations that occurred since the last call.
+     *  @return Number of calls made.
+     *  @note   Call it from the event loop when fd() is readable. Never blocks.
+     */
+    inline std::size_t dispatch_ready()
+    {
+        std::uint64_t expirations = 0;
+
+        if(::read(_fd, &expirations, sizeof(expirations)) != static_cast<ssize_t>(sizeof(expirations)) || _stopped)
+        {
+            return 0;
+        }
+
+        _fired = true;
+
+        const auto mode     = period_mode();
+        const bool periodic = !single_shot() && mode != ste::period_mode::relative;
+
+        std::uint64_t calls = 1;
+
+        if(periodic && expirations > 1)
+        {
+            if(mode == ste::period_mode::catch_up)
+            {
+                calls = expirations;
+            }
+
+            _missed_ticks += expirations - 1;
+        }
+
+        std::size_t count = 0;
+
+        while(count < calls && !_stopped)
+        {
+            _function.read([](function_t& f) { f(); });
+            ++count;
+
+            if(single_shot())
+            {
+                break;
+            }
+        }
+
+        if(single_shot())
+        {
+            //Also stop if set to single shot mode while running
+            stop();
+        }
+        else if(!_stopped && (mode == ste::period_mode::relative || (mode == ste::period_mode::reanchor && expirations > 1)))
+        {
+            arm(interval(), periodic ? interval() : interval_t::zero());
+        }
+
+        return count;
+    }
+
+    /*********************************************************************/
+    /*                       Accessors / Mutators                        */
+    /*********************************************************************/
+
+    /// Returns the timerfd, readable when dispatch_ready() has work. Owned by the timer.
+    inline int fd() const
+    {
+        return _fd;
+    }
+
+    /// Returns 'true' if the timer is running, 'false' otherwise.
+    inline bool running() const
+    {
+        return !stopped();
+    }
+
+    /// Returns 'true' if the timer is stopped, 'false' otherwise.
+    inline bool stopped() const
+    {
+        return _stopped.load();
+    }
+
+    /// Sets the timer to single shot or continuous mode.
+    inline void set_single_shot(const bool single_shot)
+    {
+        _single_shot = single_shot;
+        rearm_keep_phase();
+    }
+
+    /// Returns 'true' if the timer is single shot.
+    inline bool single_shot() const
+    {
+        return _single_shot;
+    }
+
+    /// Sets timer delay (duration before first call). Re-arms the timer if it is still waiting for its first call.
+    inline void set_delay(const delay_t delay)
+    {
+        _delay = delay;
+
+        if(running() && !_fired)
+        {
+            arm_from_now();
+        }
+    }
+
+    /// Sets timer delay (duration before first call).
+    inline void set_delay(const std::uint64_t delay)
+    {
+        set_delay(static_cast<delay_t>(delay));
+    }
+
+    /// Returns the duration to wait before the first call.
+    inline delay_t delay() const
+    {
+        return _delay.load();
+    }
+
+    /// Sets timer interval (duration between calls). Re-arms the timer if it is running.
+    inline void set_interval(const interval_t interval)
+    {
+        _interval = interval;
+
+        if(running())
+        {
+            if(_fired)
+            {
+                arm(interval, is_periodic() ? interval : interval_t::zero());
+            }
+            else
+            {
+                arm_from_now();
+            }
+        }
+    }
+
+    /// Sets timer interval (duration between calls).
+    inline void set_interval(const std::uint64_t interval)
+    {
+        set_interval(static_cast<interval_t>(interval));
+    }
+
+    /// Returns the duration between two function calls.
+    inline interval_t interval() const
+    {
+        return _interval.load();
+    }
+
+    /// Sets how deadlines are computed in continuous mode (see ste::period_mode).
+    inline void set_period_mode(const ste::period_mode mode)
+    {
+        _period_mode = mode;
+        rearm_keep_phase();
+    }
+
+    /// Returns how deadlines are computed in continuous mode.
+    inline ste::period_mode period_mode() const
+    {
+        return _period_mode.load();
+    }
+
+    /// Returns the number of ticks that were not fired on time (see ste::timer::missed_ticks()).
+    inline std::uint64_t missed_ticks() const
+    {
+        return _missed_ticks.load();
+    }
+
+    /// Sets the function called by the timer.
+    inline void set_function(function_t func)
+    {
+        _function.store(std::move(func));
+    }
+
+    /// Returns a copy of the function called by the timer.
+    inline function_t function() const
+    {
+        return _function.load();
+    }
+
+    /*********************************************************************/
+    /*                            Operators                              */
+    /*********************************************************************/
+
+    inline friend std::ostream& operator<<(std::ostream& out, const timerfd_timer& t)
+    {
+        return out << "ste::timerfd_timer:\n"
+                   << "    Fd: " << t.fd() << "\n"
+                   << "    Interval: " << t.interval().count() << detail::duration_unit<interval_t>() << "\n"
+                   << "    Delay: " << t.delay().count() << detail::duration_unit<delay_t>() << "\n"
+                   << "    Single-shot: " << t.single_shot();
+    }
+
+private:
+
+    /*********************************************************************/
+    /*                              Internals                            */
+    /*********************************************************************/
+
+    /// 'true' if the kernel re-arms the timer by itself.
+    inline bool is_periodic() const
+    {
+        return !single_shot() && period_mode() != ste::period_mode::relative;
+    }
+
+    /// Arms the first expiration at now + delay + interval.
+    inline void arm_from_now()
+    {
+        arm(std::chrono::duration_cast<std::chrono::nanoseconds>(delay()) + std::chrono::duration_cast<std::chrono::nanoseconds>(interval()),
+            is_periodic() ? interval() : interval_t::zero());
+    }
+
+    /// Updates the periodicity of a running timer without moving its next expiration.
+    inline void rearm_keep_phase()
+    {
+        itimerspec current = {};
+
+        if(running() && ::timerfd_gettime(_fd, &current) == 0 && (current.it_value.tv_sec != 0 || current.it_value.tv_nsec != 0))
+        {
+            const auto remaining = std::chrono::seconds(current.it_value.tv_sec) + std::chrono::nanoseconds(current.it_value.tv_nsec);
+            arm(remaining, is_periodic() ? interval() : interval_t::zero());
+        }
+    }
+
+    /**
+     *  @brief Arms the timerfd relative to now. A zero 'value' disarms it.
+     *  @note  Zero durations while running are rounded up to 1 ns: the kernel would disarm the timer.
+     */
+    template<typename value_t, typename period_t>
+    inline void arm(const value_t value, const period_t period)
+    {
+        const auto to_timespec = [](const std::chrono::nanoseconds d) -> timespec
+        {
+            const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(d);
+            return {static_cast<time_t>(seconds.count()), static_cast<long>((d - seconds).count())};
+        };
+
+        auto v = std::chrono::duration_cast<std::chrono::nanoseconds>(value);
+        auto p = std::chrono::duration_cast<std::chrono::nanoseconds>(period);
+
+        if(running())
+        {
+            v = std::max(v, std::chrono::nanoseconds(1));
+        }
+
+        if(p.count() < 0)
+        {
+            p = std::chrono::nanoseconds::zero();
+        }
+
+        const itimerspec spec = {to_timespec(p), to_timespec(v)};
+        ::timerfd_settime(_fd, 0, &spec, nullptr);
+    }
+};
+
+} //namespace ste
+
+#endif //defined(__linux__)
+#endif //STE_timerfd_timer_HPP
@@ -0,0 +1,290 @@
+/*
+ *         Copyright (C) <2020-2022>  DUHAMEL Erwan
+ *
+ *                      BSD-2 License
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without modification,
+ *  are permitted provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+ *  OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STE_trace_HPP
+#define STE_trace_HPP
+
+#include <atomic>
+
+#include <chrono>
+
+#include <cstddef>
+
+#include <cstdint>
+
+#include <cstdlib>
+
+#include <cstring>
+
+#include <mutex>
+
+#include <string>
+
+#include <type_traits>
+
+#if defined(__linux__)
+#include <fcntl.h>
+
+#include <sys/mman.h>
+
+#include <sys/syscall.h>
+
+#include <unistd.h>
+#endif
+
+namespace ste
+{
+
+/**
+    @short Binary trace of timer activity, written to per-thread memory-mapped ring buffers.
+
+    @details
+    When STE_TIMER_TRACE is defined (CMake option -DSTE_TIMER_TRACE=ON), ste::timer records
+    its starts, its stops (stop(), and the end of a single shot or of a function returning
+    false), its calls and its overruns with trace::record(). Each thread writes to its own
+    file, <directory>/ste-trace.<pid>.<tid>.bin, mapped in memory: a header followed by a ring
+    of trace::event. Recording an event is a few stores, without lock, allocation nor system
+    call; only the first event of a thread opens and maps its file. The files survive a crash,
+    and the most recent events overwrite the oldest ones.
+
+    tools/trace2json converts the files to Chrome trace-event JSON, for Perfetto or chrome://tracing.
+
+    The directory is $STE_TIMER_TRACE_DIR, or /tmp, unless set_directory() is called before the
+    first event. Only supported on Linux: elsewhere, record() does nothing.
+*/
+namespace trace
+{
+
+/// Kind of a trace::event.
+enum class event_type : std::uint16_t
+{
+    start   = 1,    ///< Timer started.
+    stop    = 2,    ///< Timer stopped.
+    fire    = 3,    ///< Function called. 'value': call duration in ns, 'lateness': ns after the deadline.
+    overrun = 4     ///< A call overran the next deadlines. 'value': number of deadlines passed.
+};
+
+/// One trace record. Timestamps are std::chrono::steady_clock nanoseconds.
+struct event
+{
+    std::uint64_t timestamp;    ///< Time of the event (beginning of the call for event_type::fire).
+    std::uint64_t timer;        ///< Address of the timer.
+    std::uint64_t value;        ///< See event_type.
+    std::int64_t lateness;      ///< See event_type.
+    std::uint32_t thread;       ///< Kernel thread id.
+    event_type type;
+    std::uint16_t reserved;
+};
+
+static_assert (sizeof(event) == 40, "ste::trace::event is a file format." );
+
+/// Beginning of a trace file, followed by 'capacity' events.
+struct file_header
+{
+    char magic[8];                      ///< "STETRACE"
+    std::uint32_t version;              ///< 1
+    std::uint32_t event_size;           ///< sizeof(event)
+    std::uint64_t capacity;             ///< Number of events in the ring.
+    std::atomic<std::uint64_t> head;    ///< Number of events ever written. Event i is at index i % capacity.
+    std::uint32_t process;              ///< pid
+    std::uint32_t thread;               ///< Kernel thread id of the writer.
+};
+
+static_assert (std::atomic<std::uint64_t>::is_always_lock_free, "ste::trace needs lock-free 64-bit atomics." );
+static_assert (sizeof(file_header) == 40, "ste::trace::file_header is a file format." );
+
+inline constexpr char magic[8]         = {'S', 'T', 'E', 'T', 'R', 'A', 'C', 'E'};
+inline constexpr std::uint32_t version = 1;
+
+namespace detail
+{
+
+/// Settings read by each thread when it maps its file.
+struct settings
+{
+    std::mutex mutex;
+    std::string directory;
+    std::size_t capacity = 65536;
+};
+
+inline settings& global_settings()
+{
+    static settings s;
+    return s;
+}
+
+#if defined(__linux__)
+/// Ring buffer of the calling thread. Unmapped when the thread exits, the file stays.
+class thread_buffer
+{
+private:
+
+    file_header* _header  = nullptr;
+    event* _events        = nullptr;
+    std::size_t _bytes    = 0;
+    std::uint32_t _thread = 0;
+
+public:
+
+    inline thread_buffer()
+    {
+        _thread = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+
+        std::string directory;
+        std::size_t capacity;
+
+        {
+            settings& s = global_settings();
+            std::lock_guard lock(s.mutex);
+
+            directory = s.directory;
+            capacity  = s.capacity;
+        }
+
+        if(directory.empty())
+        {
+            const char* env = std::getenv("STE_TIMER_TRACE_DIR");
+            directory       = env != nullptr ? env : "/tmp";
+        }
+
+        const std::string path = directory + "/ste-trace." + std::to_string(::getpid()) + "." + std::to_string(_thread) + ".bin";
+
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if(fd < 0)
+        {
+            return; // Events of this thread are dropped.
+        }
+
+        const std::size_t bytes = sizeof(file_header) + capacity * sizeof(event);
+
+        if(::ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+        {
+            void* const memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if(memory != MAP_FAILED)
+            {
+                _bytes  = bytes;
+                _header = static_cast<file_header*>(memory);
+                _events = reinterpret_cast<event*>(static_cast<char*>(memory) + sizeof(file_header));
+
+                std::memcpy(_header->magic, magic, sizeof(magic));
+                _header->version    = version;
+                _header->event_size = sizeof(event);
+                _header->capacity   = capacity;
+                _header->process    = static_cast<std::uint32_t>(::getpid());
+                _header->thread     = _thread;
+                _header->head.store(0, std::memory_order_release);
+            }
+        }
+
+        ::close(fd);
+    }
+
+    inline ~thread_buffer()
+    {
+        if(_header != nullptr)
+        {
+            ::munmap(_header, _bytes);
+        }
+    }
+
+    thread_buffer(const thread_buffer&)            = delete;
+    thread_buffer& operator=(const thread_buffer&) = delete;
+
+    /// Appends an event. Only called by the owning thread.
+    inline void write(const event_type type, const std::uint64_t timestamp, const void* const timer,
+                      const std::uint64_t value, const std::int64_t lateness)
+    {
+        if(_header == nullptr)
+        {
+            return;
+        }
+
+        const std::uint64_t head = _header->head.load(std::memory_order_relaxed);
+
+        event& e    = _events[head % _header->capacity];
+        e.timestamp = timestamp;
+        e.timer     = reinterpret_cast<std::uintptr_t>(timer);
+        e.value     = value;
+        e.lateness  = lateness;
+        e.thread    = _thread;
+        e.type      = type;
+        e.reserved  = 0;
+
+        // Readers of a live file see complete events up to 'head'.
+        _header->head.store(head + 1, std::memory_order_release);
+    }
+};
+#endif
+
+} //namespace detail
+
+/// Sets the directory of the trace files. Only affects threads that have not recorded any event yet.
+inline void set_directory(std::string directory)
+{
+    detail::settings& s = detail::global_settings();
+    std::lock_guard lock(s.mutex);
+    s.directory = std::move(directory);
+}
+
+/// Sets the number of events kept per thread. Default is 65536. Only affects threads that have not recorded any event yet.
+inline void set_capacity(const std::size_t capacity)
+{
+    detail::settings& s = detail::global_settings();
+    std::lock_guard lock(s.mutex);
+    s.capacity = capacity != 0 ? capacity : 1;
+}
+
+/// Returns the current time, as recorded in events.
+inline std::uint64_t now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// Records an event in the ring buffer of the calling thread.
+inline void record(const event_type type, const void* const timer, const std::uint64_t value = 0,
+                   const std::int64_t lateness = 0, const std::uint64_t timestamp = now())
+{
+#if defined(__linux__)
+    thread_local detail::thread_buffer buffer;
+    buffer.write(type, timestamp, timer, value, lateness);
+#else
+    static_cast<void>(type);
+    static_cast<void>(timer);
+    static_cast<void>(value);
+    static_cast<void>(lateness);
+    static_cast<void>(timestamp);
+#endif
+}
+
+} //namespace trace
+} //namespace ste
+#endif //STE_trace_HPP
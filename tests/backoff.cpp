@@ -0,0 +1,130 @@
+/*
+                        ste::timer tests: backoff
+
+                 Growth up to the cap, reset on work.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "backoff.hpp"
+
+#include "manual_clock.hpp"
+
+#include "timer.hpp"
+
+#include <chrono>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+void idle_polls_grow_the_interval_up_to_the_cap()
+{
+    ste::backoff b([]() { return false; }, 1ms, 20ms);
+
+    std::vector<std::chrono::nanoseconds> intervals;
+    std::chrono::nanoseconds previous = 0ms;
+
+    for(int i = 0; i < 7; ++i)
+    {
+        previous = b(previous);
+        intervals.push_back(previous);
+    }
+
+    STE_CHECK((intervals == std::vector<std::chrono::nanoseconds>{2ms, 4ms, 8ms, 16ms, 20ms, 20ms, 20ms}));
+}
+
+void work_resets_the_interval()
+{
+    bool work = false;
+    ste::backoff b([&work]() { return work; }, 1ms, 100ms);
+
+    STE_CHECK(b(b(0ms)) == 4ms);
+
+    work = true;
+    STE_CHECK(b(4ms) == 1ms);
+
+    work = false;
+    STE_CHECK(b(1ms) == 2ms);
+    STE_CHECK(b(0ms) == 2ms);
+}
+
+void the_factor_is_applied_to_each_idle_poll()
+{
+    ste::backoff b([]() { return false; }, 10ms, 1000ms, 1.5);
+
+    STE_CHECK(b(0ms) == 15ms);
+    STE_CHECK(b(15ms) == 22500us);
+}
+
+void the_timer_keeps_the_interval_and_restarts_from_min()
+{
+    std::vector<long> calls;
+    const auto start = ste::manual_clock::now();
+
+    auto poll = [&]()
+    {
+        calls.push_back(static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(ste::manual_clock::now() - start).count()));
+        return false;
+    };
+
+    ste::timer<ste::backoff<decltype(poll)>, std::chrono::milliseconds, std::chrono::milliseconds, ste::manual_clock>
+        t(ste::backoff(poll, 1ms, 20ms), 1ms, {}, false, true);
+
+    ste::manual_clock::advance(60ms);
+    STE_CHECK((calls == std::vector<long>{1, 3, 7, 15, 31, 51}));
+
+    // A copy taken between calls holds no interval of its own.
+    const auto copy = t.function();
+    STE_CHECK(copy.min() == 1ms && copy.max() == 20ms);
+
+    t.stop();
+    calls.clear();
+    t.start();
+    ste::manual_clock::advance(10ms);
+    t.stop();
+
+    STE_CHECK((calls == std::vector<long>{61, 63, 67}));
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("idle polls grow the interval up to the cap", idle_polls_grow_the_interval_up_to_the_cap);
+    ste::test::run("work resets the interval", work_resets_the_interval);
+    ste::test::run("the factor is applied to each idle poll", the_factor_is_applied_to_each_idle_poll);
+    ste::test::run("the timer keeps the interval and restarts from min", the_timer_keeps_the_interval_and_restarts_from_min);
+
+    return ste::test::result();
+}
@@ -0,0 +1,156 @@
+/*
+                        ste::timer tests: batcher
+
+                 Size and interval triggers, batch bounds and a full ring,
+                 on a service driven by dispatch_ready().
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "batcher.hpp"
+
+#include "timer_service.hpp"
+
+#include <chrono>
+
+#include <functional>
+
+#include <thread>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+using batcher_type = ste::batcher<int, std::function<void(std::vector<int>&)>>;
+
+namespace
+{
+
+void a_full_batch_is_handed_over_immediately()
+{
+    ste::timer_service service(0);
+    std::vector<std::vector<int>> batches;
+
+    batcher_type b(service, [&](std::vector<int>& batch) { batches.push_back(batch); }, 4, std::chrono::hours(1));
+
+    for(int i = 0; i < 3; ++i)
+    {
+        STE_CHECK(b.push(i));
+    }
+
+    service.dispatch_ready();
+    STE_CHECK(batches.empty());
+
+    STE_CHECK(b.push(3));
+    service.dispatch_ready();
+
+    STE_CHECK((batches == std::vector<std::vector<int>>{{0, 1, 2, 3}}));
+}
+
+void batches_never_exceed_max_batch()
+{
+    ste::timer_service service(0);
+    std::vector<std::size_t> sizes;
+
+    {
+        batcher_type b(service, [&](std::vector<int>& batch) { sizes.push_back(batch.size()); }, 4, std::chrono::hours(1), 16);
+
+        for(int i = 0; i < 10; ++i)
+        {
+            STE_CHECK(b.push(i));
+        }
+
+        service.dispatch_ready();
+        STE_CHECK((sizes == std::vector<std::size_t>{4, 4}));
+        STE_CHECK(b.size() == 2);
+    }
+
+    // The destructor hands the rest over.
+    STE_CHECK((sizes == std::vector<std::size_t>{4, 4, 2}));
+}
+
+void a_partial_batch_waits_for_the_interval()
+{
+    ste::timer_service service(0);
+    std::vector<int> items;
+
+    batcher_type b(service, [&](std::vector<int>& batch) { items.insert(items.end(), batch.begin(), batch.end()); }, 64, 20ms);
+
+    STE_CHECK(b.push(7));
+    service.dispatch_ready();
+    STE_CHECK(items.empty());
+
+    std::this_thread::sleep_for(25ms);
+    service.dispatch_ready();
+
+    STE_CHECK((items == std::vector<int>{7}));
+}
+
+void flush_hands_a_partial_batch_over()
+{
+    ste::timer_service service(0);
+    std::vector<int> items;
+
+    batcher_type b(service, [&](std::vector<int>& batch) { items.insert(items.end(), batch.begin(), batch.end()); }, 64, std::chrono::hours(1));
+
+    STE_CHECK(b.push(1));
+    b.flush();
+    service.dispatch_ready();
+
+    STE_CHECK((items == std::vector<int>{1}));
+}
+
+void push_fails_when_the_ring_is_full()
+{
+    ste::timer_service service(0);
+
+    batcher_type b(service, [](std::vector<int>&) {}, 64, std::chrono::hours(1), 4);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        STE_CHECK(b.push(i));
+    }
+
+    STE_CHECK(!b.push(4));
+    STE_CHECK(b.size() == 4);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("a full batch is handed over immediately", a_full_batch_is_handed_over_immediately);
+    ste::test::run("batches never exceed max_batch", batches_never_exceed_max_batch);
+    ste::test::run("a partial batch waits for the interval", a_partial_batch_waits_for_the_interval);
+    ste::test::run("flush hands a partial batch over", flush_hands_a_partial_batch_over);
+    ste::test::run("push fails when the ring is full", push_fails_when_the_ring_is_full);
+
+    return ste::test::result();
+}
@@ -0,0 +1,99 @@
+/*
+                        ste::timer tests: checks
+
+                 Minimal assertion helpers shared by the tests.
+                 Each test is an executable run by ctest: a non-zero
+                 exit code is a failure.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef STE_tests_check_HPP
+#define STE_tests_check_HPP
+
+#include <chrono>
+
+#include <cstdio>
+
+#include <functional>
+
+#include <thread>
+
+namespace ste::test
+{
+
+/// Number of failed checks.
+inline int failures = 0;
+
+/// Records a failed check.
+inline void fail(const char* expression, const char* file, const int line)
+{
+    ++failures;
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+}
+
+/// Runs 'test', reporting its name.
+inline void run(const char* name, const std::function<void()>& test)
+{
+    const int before = failures;
+    test();
+    std::printf("%s %s\n", failures == before ? "[ OK ]" : "[FAIL]", name);
+}
+
+/// Exit code of the test executable.
+inline int result()
+{
+    return failures == 0 ? 0 : 1;
+}
+
+/// Polls 'condition' until it holds or 'timeout' elapses. Returns its last value.
+template<typename condition_f>
+inline bool eventually(const condition_f condition,
+                       const std::chrono::milliseconds timeout = std::chrono::seconds(5))
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while(!condition())
+    {
+        if(std::chrono::steady_clock::now() >= deadline)
+        {
+            return condition();
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+} //namespace ste::test
+
+/// Records a failure if 'condition' is false, and carries on.
+#define STE_CHECK(condition) ((condition) ? (void)0 : ste::test::fail(#condition, __FILE__, __LINE__))
+
+#endif //STE_tests_check_HPP
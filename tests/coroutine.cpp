@@ -0,0 +1,196 @@
+/*
+                        ste::timer tests: coroutine
+
+                 sleep_for(), sleep_until() and every() on a 0-thread service driven by
+                 dispatch_ready(). Requires C++20.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "coroutine.hpp"
+
+#include <chrono>
+
+#include <coroutine>
+
+#include <exception>
+
+#include <thread>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/// Coroutine that starts at once and keeps its frame until destroyed.
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    task(const std::coroutine_handle<promise_type> h) : handle(h) {}
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() { handle.destroy(); }
+
+    bool done() const { return handle.done(); }
+};
+
+/// Runs the due callbacks of 'service' until 'cond' holds, or for 5s.
+template<typename condition_f>
+bool dispatch_until(ste::timer_service& service, const condition_f cond)
+{
+    return ste::test::eventually([&]()
+    {
+        service.dispatch_ready();
+        return cond();
+    });
+}
+
+task sleep_then_return(ste::timer_service& service, const std::chrono::milliseconds duration)
+{
+    co_await ste::sleep_for(duration, {}, service);
+}
+
+void sleep_for_resumes_after_the_duration()
+{
+    ste::timer_service service(0);
+
+    const auto start = ste::timer_service::clock::now();
+    task t = sleep_then_return(service, 10ms);
+
+    STE_CHECK(!t.done());
+    STE_CHECK(service.size() == 1);
+
+    STE_CHECK(dispatch_until(service, [&]() { return t.done(); }));
+    STE_CHECK(ste::timer_service::clock::now() - start >= 10ms);
+    STE_CHECK(service.size() == 0);
+}
+
+task sleep_until(ste::timer_service& service, const ste::timer_service::time_point deadline)
+{
+    co_await ste::sleep_until(deadline, {}, service);
+}
+
+void sleep_until_a_past_deadline_does_not_suspend()
+{
+    ste::timer_service service(0);
+
+    task t = sleep_until(service, ste::timer_service::clock::now() - 1ms);
+
+    STE_CHECK(t.done());
+    STE_CHECK(service.size() == 0);
+}
+
+task count_ticks(ste::timer_service& service, std::vector<ste::tick>& ticks, const std::size_t count)
+{
+    auto periodic = ste::every(5ms, {}, service);
+
+    while(ticks.size() < count)
+    {
+        ticks.push_back(co_await periodic.next());
+    }
+}
+
+void every_ticks_at_absolute_deadlines()
+{
+    ste::timer_service service(0);
+    std::vector<ste::tick> ticks;
+
+    task t = count_ticks(service, ticks, 3);
+
+    STE_CHECK(dispatch_until(service, [&]() { return t.done(); }));
+    STE_CHECK(ticks.size() == 3);
+
+    for(std::size_t i = 0; i < ticks.size(); ++i)
+    {
+        STE_CHECK(ticks[i].index == i + 1);
+        STE_CHECK(ticks[i].missed == 0);
+
+        if(i != 0)
+        {
+            STE_CHECK(ticks[i].deadline - ticks[i - 1].deadline == 5ms);
+        }
+    }
+}
+
+void every_reports_the_ticks_it_skips()
+{
+    ste::timer_service service(0);
+    std::vector<ste::tick> ticks;
+
+    task t = count_ticks(service, ticks, 2);
+
+    // The first resumption is 20ms late: the deadlines passed meanwhile are skipped.
+    std::this_thread::sleep_for(25ms);
+
+    STE_CHECK(dispatch_until(service, [&]() { return t.done(); }));
+    STE_CHECK(ticks.size() == 2);
+    STE_CHECK(ticks[1].missed >= 3);
+    STE_CHECK(ticks[1].index == ticks[1].missed + 2);
+}
+
+void destroying_a_suspended_coroutine_cancels_its_resumption()
+{
+    ste::timer_service service(0);
+
+    {
+        task t = sleep_then_return(service, 5ms);
+        STE_CHECK(service.size() == 1);
+    }
+
+    STE_CHECK(service.size() == 0);
+
+    std::this_thread::sleep_for(10ms);
+    STE_CHECK(service.dispatch_ready() == 0);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("sleep_for resumes after the duration", sleep_for_resumes_after_the_duration);
+    ste::test::run("sleep_until a past deadline does not suspend", sleep_until_a_past_deadline_does_not_suspend);
+    ste::test::run("every ticks at absolute deadlines", every_ticks_at_absolute_deadlines);
+    ste::test::run("every reports the ticks it skips", every_reports_the_ticks_it_skips);
+    ste::test::run("destroying a suspended coroutine cancels its resumption", destroying_a_suspended_coroutine_cancels_its_resumption);
+
+    return ste::test::result();
+}
@@ -0,0 +1,198 @@
+/*
+                        ste::timer tests: fixed_timer
+
+                 Periodic and single-shot calls, immediate stop,
+                 restart from the function and concurrent start().
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "fixed_timer.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <functional>
+
+#include <thread>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+void periodic_timers_fire_until_stopped()
+{
+    std::atomic<int> calls = 0;
+
+    ste::fixed_timer<std::function<void()>, std::chrono::milliseconds, 2> t([&]() { ++calls; }, true);
+
+    STE_CHECK(ste::test::eventually([&]() { return calls >= 5; }));
+    t.stop();
+
+    const int stopped = calls;
+    std::this_thread::sleep_for(10ms);
+
+    STE_CHECK(calls == stopped);
+}
+
+void single_shot_timers_fire_once()
+{
+    std::atomic<int> calls = 0;
+
+    ste::fixed_timer<std::function<void()>, std::chrono::milliseconds, 1, ste::shot::single> t([&]() { ++calls; }, true);
+
+    STE_CHECK(ste::test::eventually([&]() { return calls == 1; }));
+    std::this_thread::sleep_for(10ms);
+
+    STE_CHECK(calls == 1);
+}
+
+void stop_interrupts_a_long_wait()
+{
+    ste::fixed_timer<std::function<void()>, std::chrono::hours, 1> t([]() {}, true);
+
+    const auto start = std::chrono::steady_clock::now();
+    t.stop();
+
+    STE_CHECK(std::chrono::steady_clock::now() - start < 1s);
+}
+
+void start_from_the_function_restarts_the_schedule()
+{
+    std::atomic<int> calls = 0;
+    ste::fixed_timer<std::function<void()>, std::chrono::milliseconds, 1, ste::shot::single>* self = nullptr;
+
+    ste::fixed_timer<std::function<void()>, std::chrono::milliseconds, 1, ste::shot::single> t([&]()
+    {
+        if(++calls < 3)
+        {
+            self->start();
+        }
+    });
+
+    self = &t;
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return calls == 3; }));
+    std::this_thread::sleep_for(10ms);
+
+    STE_CHECK(calls == 3);
+}
+
+void stop_wins_over_start_from_the_function()
+{
+    std::atomic<bool> calling  = false;
+    std::atomic<bool> stopping = false;
+    std::atomic<bool> stopped  = false;
+    ste::fixed_timer<std::function<void()>, std::chrono::milliseconds, 1, ste::shot::single>* self = nullptr;
+
+    ste::fixed_timer<std::function<void()>, std::chrono::milliseconds, 1, ste::shot::single> t([&]()
+    {
+        calling = true;
+
+        // Restarts once stop() is waiting for this call.
+        while(!stopping)
+        {
+            std::this_thread::yield();
+        }
+
+        std::this_thread::sleep_for(5ms);
+        self->start();
+    });
+
+    self = &t;
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return calling.load(); }));
+
+    std::thread stopper([&]()
+    {
+        stopping = true;
+        t.stop();
+        stopped = true;
+    });
+
+    STE_CHECK(ste::test::eventually([&]() { return stopped.load(); }));
+    stopper.join();
+}
+
+void concurrent_starts_and_stops_are_safe()
+{
+    std::atomic<int> calls = 0;
+
+    ste::fixed_timer<std::function<void()>, std::chrono::microseconds, 100> t([&]() { ++calls; });
+
+    std::vector<std::thread> threads;
+
+    for(int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&t, i]()
+        {
+            for(int j = 0; j < 50; ++j)
+            {
+                if((i + j) % 3 == 0)
+                {
+                    t.stop();
+                }
+                else
+                {
+                    t.start();
+                }
+            }
+        });
+    }
+
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    t.start();
+    STE_CHECK(ste::test::eventually([&]() { return calls > 0; }));
+    t.stop();
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("periodic timers fire until stopped", periodic_timers_fire_until_stopped);
+    ste::test::run("single shot timers fire once", single_shot_timers_fire_once);
+    ste::test::run("stop interrupts a long wait", stop_interrupts_a_long_wait);
+    ste::test::run("start from the function restarts the schedule", start_from_the_function_restarts_the_schedule);
+    ste::test::run("stop wins over start from the function", stop_wins_over_start_from_the_function);
+    ste::test::run("concurrent starts and stops are safe", concurrent_starts_and_stops_are_safe);
+
+    return ste::test::result();
+}
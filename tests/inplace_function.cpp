@@ -0,0 +1,152 @@
+/*
+                        ste::timer tests: inplace_function
+
+                 Copies, moves, empty functions and the lifetime of the stored callable.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "inplace_function.hpp"
+
+#include <functional>
+
+namespace
+{
+
+/// Callable counting its live instances.
+struct counted
+{
+    static inline int instances = 0;
+
+    int* calls;
+
+    explicit counted(int* c) : calls(c) { ++instances; }
+    counted(const counted& other) : calls(other.calls) { ++instances; }
+    counted(counted&& other) noexcept : calls(other.calls) { ++instances; }
+    ~counted() { --instances; }
+
+    void operator()() const { ++*calls; }
+};
+
+int twice(const int x)
+{
+    return 2 * x;
+}
+
+void copies_are_independent()
+{
+    int n = 0;
+    const ste::inplace_function<int(void)> a = [n]() mutable { return ++n; };
+
+    STE_CHECK(a() == 1);
+
+    auto b = a;
+    STE_CHECK(b() == 2);
+    STE_CHECK(a() == 2);
+
+    ste::inplace_function<int(void)> c;
+    c = b;
+    STE_CHECK(c() == 3);
+    STE_CHECK(b() == 3);
+}
+
+void moves_empty_the_source()
+{
+    int calls = 0;
+
+    {
+        ste::inplace_function<void(void)> a = counted(&calls);
+        STE_CHECK(counted::instances == 1);
+
+        ste::inplace_function<void(void)> b = std::move(a);
+        STE_CHECK(!a);
+        STE_CHECK(b);
+        STE_CHECK(counted::instances == 1);
+
+        ste::inplace_function<void(void)> c;
+        c = std::move(b);
+        STE_CHECK(!b);
+        STE_CHECK(counted::instances == 1);
+
+        c();
+        STE_CHECK(calls == 1);
+
+        c = nullptr;
+        STE_CHECK(counted::instances == 0);
+    }
+
+    STE_CHECK(counted::instances == 0);
+}
+
+void calling_an_empty_function_throws()
+{
+    const ste::inplace_function<void(void)> f;
+    bool thrown = false;
+
+    try
+    {
+        f();
+    }
+    catch(const std::bad_function_call&)
+    {
+        thrown = true;
+    }
+
+    STE_CHECK(!f);
+    STE_CHECK(thrown);
+}
+
+void null_function_pointers_are_empty()
+{
+    int (*null)(int) = nullptr;
+
+    const ste::inplace_function<int(int)> f = null;
+    STE_CHECK(!f);
+
+    const ste::inplace_function<int(int)> g = &twice;
+    STE_CHECK(g);
+    STE_CHECK(g(21) == 42);
+
+    int (counted::*member)() = nullptr;
+    const ste::inplace_function<int(counted&)> h = member;
+    STE_CHECK(!h);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("copies are independent", copies_are_independent);
+    ste::test::run("moves empty the source", moves_empty_the_source);
+    ste::test::run("calling an empty function throws", calling_an_empty_function_throws);
+    ste::test::run("null function pointers are empty", null_function_pointers_are_empty);
+
+    return ste::test::result();
+}
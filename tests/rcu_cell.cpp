@@ -0,0 +1,150 @@
+/*
+                        ste::timer tests: rcu_cell
+
+                 Replacement from other threads and from inside read().
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "rcu_cell.hpp"
+
+#include <atomic>
+
+#include <thread>
+
+#include <vector>
+
+namespace
+{
+
+void readers_see_complete_values()
+{
+    ste::rcu_cell<std::vector<int>> cell(std::vector<int>(64, 0));
+    std::atomic<bool> done = false;
+    std::atomic<int> torn  = 0;
+
+    std::thread reader([&]()
+    {
+        while(!done)
+        {
+            cell.read([&](const std::vector<int>& v)
+            {
+                for(const int x : v)
+                {
+                    torn += x != v.front();
+                }
+            });
+        }
+    });
+
+    for(int i = 1; i <= 2000; ++i)
+    {
+        cell.store(std::vector<int>(64, i));
+    }
+
+    done = true;
+    reader.join();
+
+    STE_CHECK(torn == 0);
+    STE_CHECK(cell.load().front() == 2000);
+}
+
+void stores_from_inside_read_do_not_wait_for_it()
+{
+    ste::rcu_cell<int> cell(0);
+
+    cell.read([&](int& value)
+    {
+        for(int i = 1; i <= 5; ++i)
+        {
+            cell.store(i);
+        }
+
+        // The read keeps its own value.
+        STE_CHECK(value == 0);
+    });
+
+    STE_CHECK(cell.load() == 5);
+}
+
+void stores_from_nested_reads_apply_when_the_outermost_returns()
+{
+    ste::rcu_cell<int> cell(0);
+
+    cell.read([&](int&)
+    {
+        cell.read([&](int&)
+        {
+            for(int i = 1; i <= 4; ++i)
+            {
+                cell.store(i);
+            }
+        });
+
+        // Still inside a read: the last value is not stored yet.
+        STE_CHECK(cell.read([](const int v) { return v; }) == 2);
+    });
+
+    STE_CHECK(cell.load() == 4);
+}
+
+void a_later_store_supersedes_a_deferred_one()
+{
+    ste::rcu_cell<int> cell(0);
+    std::thread other;
+
+    cell.read([&](int&)
+    {
+        for(int i = 1; i <= 3; ++i)
+        {
+            cell.store(i);
+        }
+
+        // Waits for this read to return, then replaces the deferred value.
+        other = std::thread([&]() { cell.store(10); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    });
+
+    other.join();
+
+    STE_CHECK(cell.load() == 10);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("readers see complete values", readers_see_complete_values);
+    ste::test::run("stores from inside read do not wait for it", stores_from_inside_read_do_not_wait_for_it);
+    ste::test::run("stores from nested reads apply when the outermost returns", stores_from_nested_reads_apply_when_the_outermost_returns);
+    ste::test::run("a later store supersedes a deferred one", a_later_store_supersedes_a_deferred_one);
+
+    return ste::test::result();
+}
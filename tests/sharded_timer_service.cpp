@@ -0,0 +1,215 @@
+/*
+                        ste::timer tests: sharded_timer_service
+
+           Shard count, pinning and its status, per-CPU routing, cross-shard handles.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "sharded_timer_service.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <thread>
+
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+
+#include <sched.h>
+
+#include <unistd.h>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+#if defined(__linux__)
+/// CPUs the process may run on, in the order the shards are given them.
+std::vector<int> process_cpus()
+{
+    std::vector<int> cpus;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    ::sched_getaffinity(::getpid(), sizeof(set), &set);
+
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if(CPU_ISSET(cpu, &set))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+/// Runs 'function' on a thread pinned to 'cpu'.
+template<typename function_t>
+void on_cpu(const int cpu, function_t function)
+{
+    std::thread([&]()
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        STE_CHECK(::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0);
+        function();
+    }).join();
+}
+#endif
+
+void shards_are_capped_at_the_cpu_count()
+{
+    const std::size_t cpus = ste::sharded_timer_service().shard_count();
+
+    STE_CHECK(cpus >= 1);
+    STE_CHECK(ste::sharded_timer_service(cpus + 3).shard_count() == cpus);
+    STE_CHECK(ste::sharded_timer_service(1).shard_count() == 1);
+}
+
+void shards_are_pinned()
+{
+    ste::sharded_timer_service services;
+
+    STE_CHECK(services.thread_status().ok());
+}
+
+void unpinnable_cpus_are_reported()
+{
+    // CPUs of the attributes are kept without 'pin', replaced with it.
+    ste::thread_attributes attributes;
+    attributes.cpus = {-1};
+
+    ste::sharded_timer_service unpinned(0, false, attributes);
+    ste::sharded_timer_service pinned(0, true, attributes);
+
+    STE_CHECK(unpinned.thread_status().affinity != 0);
+    STE_CHECK(unpinned.shard(0).thread_status().affinity != 0);
+    STE_CHECK(pinned.thread_status().ok());
+}
+
+#if defined(__linux__)
+void dispatchers_run_on_their_cpu()
+{
+    const std::vector<int> cpus = process_cpus();
+    ste::sharded_timer_service services;
+
+    STE_CHECK(services.shard_count() == cpus.size());
+
+    for(std::size_t i = 0; i < services.shard_count(); ++i)
+    {
+        std::atomic<int> cpu = -1;
+
+        services.shard(i).schedule_after(0ms, [&]() { cpu = ::sched_getcpu(); });
+
+        STE_CHECK(ste::test::eventually([&]() { return cpu != -1; }));
+        STE_CHECK(cpu == cpus[i]);
+    }
+}
+
+void scheduling_goes_to_the_shard_of_the_cpu()
+{
+    const std::vector<int> cpus = process_cpus();
+    ste::sharded_timer_service services;
+    ste::sharded_timer_service shared((cpus.size() + 1) / 2);
+
+    for(std::size_t i = 0; i < cpus.size(); ++i)
+    {
+        on_cpu(cpus[i], [&]()
+        {
+            const auto handle = services.schedule_after(1h, []() {});
+
+            STE_CHECK(handle.shard == i);
+            STE_CHECK(&services.local_shard() == &services.shard(i));
+            STE_CHECK(services.cancel(handle));
+
+            // Fewer shards than CPUs: round-robin.
+            STE_CHECK(&shared.local_shard() == &shared.shard(i % shared.shard_count()));
+        });
+    }
+}
+
+void a_restricted_caller_still_gets_every_cpu()
+{
+    const std::vector<int> cpus = process_cpus();
+
+    on_cpu(cpus.back(), [&]()
+    {
+        STE_CHECK(ste::sharded_timer_service().shard_count() == cpus.size());
+    });
+}
+#endif
+
+void handles_work_from_any_thread()
+{
+    ste::sharded_timer_service services;
+    std::atomic<int> fired = 0;
+
+    ste::sharded_timer_service::id cancelled;
+    ste::sharded_timer_service::id kept;
+
+    std::thread([&]()
+    {
+        cancelled = services.schedule_after(50ms, [&]() { fired += 100; });
+        kept      = services.schedule_after(1ms, [&]() { ++fired; });
+    }).join();
+
+    STE_CHECK(services.cancel(cancelled));
+    STE_CHECK(ste::test::eventually([&]() { return fired == 1; }));
+    STE_CHECK(!services.pending(kept));
+
+    std::this_thread::sleep_for(60ms);
+    STE_CHECK(fired == 1);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("shards are capped at the CPU count", shards_are_capped_at_the_cpu_count);
+    ste::test::run("shards are pinned", shards_are_pinned);
+    ste::test::run("unpinnable CPUs are reported", unpinnable_cpus_are_reported);
+#if defined(__linux__)
+    ste::test::run("dispatchers run on their CPU", dispatchers_run_on_their_cpu);
+    ste::test::run("scheduling goes to the shard of the CPU", scheduling_goes_to_the_shard_of_the_cpu);
+    ste::test::run("a restricted caller still gets every CPU", a_restricted_caller_still_gets_every_cpu);
+#endif
+    ste::test::run("handles work from any thread", handles_work_from_any_thread);
+
+    return ste::test::result();
+}
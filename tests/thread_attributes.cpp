@@ -0,0 +1,161 @@
+/*
+                        ste::timer tests: thread_attributes
+
+                 Settings applied at creation, fallbacks when they cannot be.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "thread_attributes.hpp"
+
+#include <atomic>
+
+#include <cstring>
+
+#if defined(__linux__)
+#include <pthread.h>
+
+#include <sched.h>
+#endif
+
+namespace
+{
+
+#if defined(__linux__)
+/// Returns the CPUs the calling thread may run on.
+cpu_set_t own_cpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+    return set;
+}
+
+void settings_apply_before_the_function_runs()
+{
+    const cpu_set_t process = own_cpus();
+
+    int first = 0;
+    while(!CPU_ISSET(first, &process))
+    {
+        ++first;
+    }
+
+    ste::thread_attributes attributes;
+    attributes.name       = "ste-test-thread";
+    attributes.cpus       = {first};
+    attributes.stack_size = 1 << 20;
+
+    char name[16]     = {};
+    int cpu_count     = 0;
+    bool on_first     = false;
+    std::size_t stack = 0;
+
+    ste::attributed_thread thread(attributes, [&]()
+    {
+        ::pthread_getname_np(::pthread_self(), name, sizeof(name));
+
+        const cpu_set_t own = own_cpus();
+        cpu_count = CPU_COUNT(&own);
+        on_first  = CPU_ISSET(first, &own);
+
+        pthread_attr_t current;
+        ::pthread_getattr_np(::pthread_self(), &current);
+        ::pthread_attr_getstacksize(&current, &stack);
+        ::pthread_attr_destroy(&current);
+    });
+
+    thread.join();
+
+    STE_CHECK(thread.status().ok());
+    STE_CHECK(std::strcmp(name, "ste-test-thread") == 0);
+    STE_CHECK(cpu_count == 1 && on_first);
+    STE_CHECK(stack >= std::size_t(1 << 20));
+}
+
+void real_time_policy_applies_or_is_reported()
+{
+    ste::thread_attributes attributes;
+    attributes.policy   = ste::sched_policy::fifo;
+    attributes.priority = 1;
+
+    int policy = -1;
+
+    ste::attributed_thread thread(attributes, [&]()
+    {
+        sched_param parameters;
+        ::pthread_getschedparam(::pthread_self(), &policy, &parameters);
+    });
+
+    thread.join();
+
+    // Without privileges, the thread runs with the default policy.
+    STE_CHECK(thread.status().scheduling != 0 ? policy == SCHED_OTHER : policy == SCHED_FIFO);
+}
+
+void invalid_cpus_are_reported_and_the_thread_still_runs()
+{
+    ste::thread_attributes attributes;
+    attributes.cpus = {CPU_SETSIZE - 1};
+
+    std::atomic<bool> ran = false;
+
+    ste::attributed_thread thread(attributes, [&]() { ran = true; });
+    thread.join();
+
+    STE_CHECK(ran);
+    STE_CHECK(thread.status().affinity != 0);
+}
+#endif
+
+void default_attributes_apply_nothing()
+{
+    std::atomic<bool> ran = false;
+
+    ste::attributed_thread thread({}, [&]() { ran = true; });
+    thread.join();
+
+    STE_CHECK(ran);
+    STE_CHECK(thread.status().ok());
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("default attributes apply nothing", default_attributes_apply_nothing);
+#if defined(__linux__)
+    ste::test::run("settings apply before the function runs", settings_apply_before_the_function_runs);
+    ste::test::run("real-time policy applies or is reported", real_time_policy_applies_or_is_reported);
+    ste::test::run("invalid CPUs are reported and the thread still runs", invalid_cpus_are_reported_and_the_thread_still_runs);
+#endif
+
+    return ste::test::result();
+}
@@ -0,0 +1,136 @@
+/*
+                        ste::timer tests: thread_pool
+
+                 Stealing between workers and shutdown.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+void every_task_runs()
+{
+    std::atomic<int> runs = 0;
+
+    {
+        ste::thread_pool pool(2);
+
+        for(int i = 0; i < 1000; ++i)
+        {
+            pool.execute([&]() { ++runs; });
+        }
+
+        STE_CHECK(ste::test::eventually([&]() { return runs == 1000; }));
+    }
+
+    STE_CHECK(runs == 1000);
+}
+
+void idle_workers_steal_queued_tasks()
+{
+    ste::thread_pool pool(2);
+
+    std::atomic<int> stolen    = 0;
+    std::atomic<bool> finished = false;
+
+    // Tasks submitted from a worker go to its own queue: while it blocks here, only the other
+    // worker can run them.
+    pool.execute([&]()
+    {
+        for(int i = 0; i < 8; ++i)
+        {
+            pool.execute([&]() { ++stolen; });
+        }
+
+        STE_CHECK(ste::test::eventually([&]() { return stolen == 8; }));
+        finished = true;
+    });
+
+    STE_CHECK(ste::test::eventually([&]() { return finished.load(); }));
+}
+
+void destructor_runs_the_remaining_tasks()
+{
+    std::atomic<int> runs = 0;
+
+    {
+        ste::thread_pool pool(1);
+
+        // Keeps the only worker busy while the others are queued.
+        pool.execute([]() { std::this_thread::sleep_for(20ms); });
+
+        for(int i = 0; i < 16; ++i)
+        {
+            pool.execute([&]() { ++runs; });
+        }
+    }
+
+    STE_CHECK(runs == 16);
+}
+
+void tasks_may_submit_tasks_during_shutdown()
+{
+    std::atomic<int> runs = 0;
+
+    {
+        ste::thread_pool pool(2);
+
+        pool.execute([&]()
+        {
+            std::this_thread::sleep_for(10ms);
+            pool.execute([&]() { ++runs; });
+        });
+    }
+
+    STE_CHECK(runs == 1);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("every task runs", every_task_runs);
+    ste::test::run("idle workers steal queued tasks", idle_workers_steal_queued_tasks);
+    ste::test::run("destructor runs the remaining tasks", destructor_runs_the_remaining_tasks);
+    ste::test::run("tasks may submit tasks during shutdown", tasks_may_submit_tasks_during_shutdown);
+
+    return ste::test::result();
+}
@@ -0,0 +1,173 @@
+/*
+                        ste::timer tests: tick_source
+
+                 Dividers, subscription from a subscriber and
+                 unsubscription, on a service driven by dispatch_ready().
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "tick_source.hpp"
+
+#include "timer_service.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <cstdint>
+
+#include <functional>
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+using tick_source_type = ste::tick_source<std::function<void()>>;
+
+namespace
+{
+
+/// Dispatches until 'ticks' has dispatched 'count' more ticks.
+void run_ticks(ste::timer_service& service, tick_source_type& ticks, const std::uint64_t count)
+{
+    const auto target = ticks.ticks() + count;
+
+    STE_CHECK(ste::test::eventually([&]()
+    {
+        service.dispatch_ready();
+        return ticks.ticks() >= target;
+    }));
+}
+
+void dividers_count_from_the_subscription()
+{
+    ste::timer_service service(0);
+    tick_source_type ticks(service, 1ms, true);
+
+    int every = 0;
+    int third = 0;
+
+    ticks.subscribe([&]() { ++every; });
+    run_ticks(service, ticks, 2);
+
+    ticks.subscribe([&]() { ++third; }, 3);
+    run_ticks(service, ticks, 9);
+    ticks.stop();
+
+    STE_CHECK(every == static_cast<int>(ticks.ticks()));
+    STE_CHECK(third == 3);
+}
+
+void unsubscribed_functions_are_not_called()
+{
+    ste::timer_service service(0);
+    tick_source_type ticks(service, 1ms, true);
+
+    int calls = 0;
+
+    const auto s = ticks.subscribe([&]() { ++calls; });
+    run_ticks(service, ticks, 2);
+
+    STE_CHECK(ticks.unsubscribe(s));
+    STE_CHECK(!ticks.unsubscribe(s));
+
+    const int before = calls;
+    run_ticks(service, ticks, 3);
+    ticks.stop();
+
+    STE_CHECK(calls == before);
+    STE_CHECK(ticks.subscriber_count() == 0);
+}
+
+void subscribing_from_a_subscriber_takes_effect_at_the_next_tick()
+{
+    ste::timer_service service(0);
+    tick_source_type ticks(service, 1ms, true);
+
+    int added_calls = 0;
+    bool added      = false;
+
+    ticks.subscribe([&]()
+    {
+        if(!added)
+        {
+            added = true;
+            ticks.subscribe([&]() { ++added_calls; });
+        }
+    });
+
+    run_ticks(service, ticks, 1);
+    STE_CHECK(added_calls == 0);
+
+    run_ticks(service, ticks, 2);
+    ticks.stop();
+
+    STE_CHECK(added_calls >= 2);
+    STE_CHECK(ticks.subscriber_count() == 2);
+}
+
+void unsubscribe_waits_for_the_tick_calling_the_subscriber()
+{
+    tick_source_type ticks(1ms, true);
+
+    std::atomic<bool> inside = false;
+    std::atomic<int> calls   = 0;
+
+    const auto s = ticks.subscribe([&]()
+    {
+        inside = true;
+        std::this_thread::sleep_for(20ms);
+        ++calls;
+        inside = false;
+    });
+
+    STE_CHECK(ste::test::eventually([&]() { return inside.load(); }));
+    STE_CHECK(ticks.unsubscribe(s));
+    STE_CHECK(!inside);
+
+    const int before = calls;
+    std::this_thread::sleep_for(10ms);
+    ticks.stop();
+
+    STE_CHECK(calls == before);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("dividers count from the subscription", dividers_count_from_the_subscription);
+    ste::test::run("unsubscribed functions are not called", unsubscribed_functions_are_not_called);
+    ste::test::run("subscribing from a subscriber takes effect at the next tick", subscribing_from_a_subscriber_takes_effect_at_the_next_tick);
+    ste::test::run("unsubscribe waits for the tick calling the subscriber", unsubscribe_waits_for_the_tick_calling_the_subscriber);
+
+    return ste::test::result();
+}
@@ -0,0 +1,530 @@
+/*
+                        ste::timer tests: timer
+
+                 Schedules on ste::manual_clock, phase and jitter, overrun policies,
+                 spinning waits, adaptive intervals.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "manual_clock.hpp"
+
+#include "thread_pool.hpp"
+
+#include "timer.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <functional>
+
+#include <stdexcept>
+
+#include <thread>
+
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+using namespace std::chrono_literals;
+
+using clock_type = ste::manual_clock;
+
+template<typename function_t>
+using manual_timer = ste::timer<function_t, std::chrono::milliseconds, std::chrono::milliseconds, clock_type>;
+
+template<typename function_t>
+using steady_timer = ste::timer<function_t, std::chrono::milliseconds, std::chrono::milliseconds>;
+
+namespace
+{
+
+/// Milliseconds since 'start'.
+long since(const clock_type::time_point start)
+{
+    return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start).count());
+}
+
+void periodic_calls_follow_delay_and_interval()
+{
+    std::vector<long> calls;
+    const auto start = clock_type::now();
+
+    manual_timer<std::function<void()>> t([&]() { calls.push_back(since(start)); }, 10ms, 5ms, false, true);
+
+    clock_type::advance(50ms);
+    t.stop();
+    clock_type::advance(50ms);
+
+    STE_CHECK((calls == std::vector<long>{15, 25, 35, 45}));
+    STE_CHECK(t.stopped());
+}
+
+void single_shot_stops_after_one_call()
+{
+    int calls = 0;
+
+    manual_timer<std::function<void()>> t([&]() { ++calls; }, 10ms, {}, true, true);
+
+    clock_type::advance(100ms);
+
+    STE_CHECK(calls == 1);
+    STE_CHECK(t.stopped());
+}
+
+void set_interval_moves_the_pending_call()
+{
+    std::vector<long> calls;
+    const auto start = clock_type::now();
+
+    manual_timer<std::function<void()>> t([&]() { calls.push_back(since(start)); }, 100ms, {}, false, true);
+
+    t.set_interval(10ms);
+    clock_type::advance(30ms);
+    t.stop();
+
+    STE_CHECK((calls == std::vector<long>{10, 20, 30}));
+}
+
+void set_function_from_the_function_does_not_deadlock()
+{
+    std::vector<int> calls;
+    manual_timer<std::function<void()>>* self = nullptr;
+
+    manual_timer<std::function<void()>> t([&]()
+    {
+        calls.push_back(0);
+
+        for(int i = 1; i <= 5; ++i)
+        {
+            self->set_function([&calls, i]() { calls.push_back(i); });
+        }
+    }, 10ms, {}, false, false);
+
+    self = &t;
+    t.start();
+
+    clock_type::advance(20ms);
+    t.stop();
+
+    STE_CHECK((calls == std::vector<int>{0, 5}));
+}
+
+void returned_durations_set_the_next_interval()
+{
+    std::vector<long> calls;
+    const auto start = clock_type::now();
+
+    manual_timer<std::function<std::chrono::milliseconds()>> t([&]()
+    {
+        calls.push_back(since(start));
+        return std::chrono::milliseconds(10 * static_cast<long>(calls.size()));
+    }, 5ms, {}, false, true);
+
+    clock_type::advance(70ms);
+    t.stop();
+
+    STE_CHECK((calls == std::vector<long>{5, 15, 35, 65}));
+}
+
+void zero_intervals_do_not_stall_simulated_time()
+{
+    bool thrown = false;
+
+    try
+    {
+        manual_timer<std::function<void()>> t([]() {}, 0ms, {}, false, true);
+    }
+    catch(const std::invalid_argument&)
+    {
+        thrown = true;
+    }
+
+    STE_CHECK(thrown);
+
+    // A zero interval returned by the function: one call per clock tick (1ns).
+    int calls = 0;
+    manual_timer<std::function<std::chrono::nanoseconds()>> t([&]() { ++calls; return 0ns; }, 1ms, {}, false, true);
+
+    clock_type::advance(1ms + 1us);
+    t.stop();
+
+    STE_CHECK(calls >= 1000 && calls <= 1001);
+}
+
+void returning_false_stops_the_timer()
+{
+    int calls = 0;
+
+    manual_timer<std::function<bool()>> t([&]() { return ++calls < 3; }, 10ms, {}, false, true);
+
+    clock_type::advance(100ms);
+
+    STE_CHECK(calls == 3);
+    STE_CHECK(t.stopped());
+}
+
+/// Runs a 10ms timer whose first call takes 25ms, until its third call. Returns missed_ticks().
+/// Returns the time of the first call of a 100ms timer with 'mode' and 'key', from its start.
+clock_type::duration first_call_with_phase(const ste::phase_mode mode, const std::uint64_t key = 0)
+{
+    clock_type::duration first = clock_type::duration::zero();
+    const auto start = clock_type::now();
+
+    manual_timer<std::function<void()>> t([&]() { first = clock_type::now() - start; }, 100ms, {}, true, false);
+    t.set_phase(mode, {}, key);
+    t.start();
+
+    clock_type::advance(200ms);
+
+    return first;
+}
+
+void phase_offsets_the_first_call_within_the_interval()
+{
+    STE_CHECK(first_call_with_phase(ste::phase_mode::none) == 100ms);
+
+    // The same key gives the same phase.
+    const auto hashed = first_call_with_phase(ste::phase_mode::hashed, 42);
+    STE_CHECK(hashed >= 100ms && hashed < 200ms);
+    STE_CHECK(first_call_with_phase(ste::phase_mode::hashed, 42) == hashed);
+
+    // Successive timers never share a phase.
+    std::vector<clock_type::duration> spread;
+
+    for(int i = 0; i < 8; ++i)
+    {
+        const auto first = first_call_with_phase(ste::phase_mode::spread);
+        STE_CHECK(first >= 100ms && first < 200ms);
+
+        for(const auto other : spread)
+        {
+            STE_CHECK(other != first);
+        }
+
+        spread.push_back(first);
+    }
+}
+
+void tick_jitter_stays_within_bounds()
+{
+    std::vector<clock_type::duration> calls;
+    const auto start = clock_type::now();
+
+    manual_timer<std::function<void()>> t([&]() { calls.push_back(clock_type::now() - start); }, 10ms, {}, false, false);
+    t.set_period_mode(ste::period_mode::catch_up);
+    t.set_tick_jitter(4ms);
+    t.start();
+
+    clock_type::advance(1005ms);
+    t.stop();
+
+    STE_CHECK(calls.size() >= 99 && calls.size() <= 101);
+
+    // Deadline k stays within 2ms of k * 10ms: the offsets do not accumulate.
+    bool jittered = false;
+
+    for(std::size_t k = 0; k < calls.size(); ++k)
+    {
+        const auto offset = calls[k] - std::chrono::duration_cast<clock_type::duration>(10ms * (k + 1));
+
+        STE_CHECK(offset >= -2ms && offset < 2ms);
+        jittered = jittered || offset != clock_type::duration::zero();
+    }
+
+    STE_CHECK(jittered);
+}
+
+void spinning_timers_fire_on_or_after_their_deadlines()
+{
+    std::vector<std::chrono::nanoseconds> lateness;
+    std::atomic<int> calls = 0;
+    steady_timer<std::function<void()>>* self = nullptr;
+
+    steady_timer<std::function<void()>> t([&]()
+    {
+        lateness.push_back(self->jitter().last); // Recorded just before the call.
+        ++calls;
+    }, 5ms, {}, false, false);
+
+    self = &t;
+    t.set_spin_threshold(2ms);
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return calls >= 20; }));
+    t.stop();
+
+    for(const auto late : lateness)
+    {
+        STE_CHECK(late >= 0ns);
+    }
+}
+
+void stop_interrupts_a_spin()
+{
+    std::atomic<int> calls = 0;
+
+    // The threshold exceeds the interval: the thread spins all the time.
+    steady_timer<std::function<void()>> t([&]() { ++calls; }, 5ms, {}, false, false);
+    t.set_spin_threshold(1s);
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return calls >= 3; }));
+
+    const auto start = std::chrono::steady_clock::now();
+    t.stop();
+
+    STE_CHECK(std::chrono::steady_clock::now() - start < 100ms);
+}
+
+#if defined(__linux__)
+void slack_becomes_the_thread_timer_slack()
+{
+    std::atomic<long> applied = -1;
+
+    steady_timer<std::function<void()>> t([&]() { applied = ::prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0); }, 1ms, {}, true, false);
+    t.set_slack(200us);
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return applied != -1; }));
+    STE_CHECK(applied == 200000);
+}
+#endif
+
+void start_stop_churn_never_overlaps_calls()
+{
+    std::atomic<int> active   = 0;
+    std::atomic<int> overlaps = 0;
+    std::atomic<int> calls    = 0;
+
+    steady_timer<std::function<void()>> t([&]()
+    {
+        if(++active != 1)
+        {
+            ++overlaps;
+        }
+
+        std::this_thread::sleep_for(100us);
+        ++calls;
+        --active;
+    }, 1ms, {}, false, false);
+
+    for(int i = 0; i < 200; ++i)
+    {
+        t.start();
+        std::this_thread::sleep_for(std::chrono::microseconds(100 * (i % 20)));
+
+        t.set_interval(std::chrono::milliseconds(1 + i % 2));
+
+        if(i % 3 == 0)
+        {
+            t.start(); // No effect while running.
+        }
+
+        t.stop(); // Does not wait for a call in progress: the next start() may overlap it.
+    }
+
+    STE_CHECK(overlaps == 0);
+    STE_CHECK(calls > 0);
+}
+
+void stop_and_destruction_do_not_wait_for_the_interval()
+{
+    using hour_timer = ste::timer<std::function<void()>, std::chrono::hours, std::chrono::hours>;
+
+    hour_timer t([]() {}, std::chrono::hours(1), {}, false, true);
+
+    auto start = std::chrono::steady_clock::now();
+    t.stop();
+    STE_CHECK(std::chrono::steady_clock::now() - start < 20ms);
+
+    start = std::chrono::steady_clock::now();
+
+    {
+        hour_timer running([]() {}, std::chrono::hours(1), {}, false, true);
+    }
+
+    STE_CHECK(std::chrono::steady_clock::now() - start < 20ms);
+}
+
+std::uint64_t missed_after_overrun(const ste::period_mode mode)
+{
+    std::atomic<int> calls = 0;
+
+    steady_timer<std::function<void()>> t([&]()
+    {
+        if(++calls == 1)
+        {
+            std::this_thread::sleep_for(25ms);
+        }
+    }, 10ms, {}, false, false);
+
+    t.set_period_mode(mode);
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return calls >= 3; }));
+    t.stop();
+
+    return t.missed_ticks();
+}
+
+void overrun_policies_count_missed_ticks()
+{
+    STE_CHECK(missed_after_overrun(ste::period_mode::relative) == 0);
+    STE_CHECK(missed_after_overrun(ste::period_mode::catch_up) >= 1);
+    STE_CHECK(missed_after_overrun(ste::period_mode::skip) >= 2);
+    STE_CHECK(missed_after_overrun(ste::period_mode::reanchor) >= 2);
+}
+
+void service_timer_restarts_from_its_function()
+{
+    int calls = 0;
+    manual_timer<std::function<void()>>* self = nullptr;
+
+    manual_timer<std::function<void()>> t([&]()
+    {
+        if(++calls == 1)
+        {
+            self->stop();
+            self->start();
+        }
+    }, 10ms, {}, false, false);
+
+    self = &t;
+    t.start();
+
+    clock_type::advance(200ms);
+    t.stop();
+
+    // One schedule, restarted at 10ms: a duplicate chain would double the calls.
+    STE_CHECK(calls == 20);
+    STE_CHECK(clock_type::service().size() == 0);
+
+    clock_type::advance(50ms);
+    STE_CHECK(calls == 20);
+}
+
+void thread_timer_restarts_from_its_function()
+{
+    std::atomic<int> calls = 0;
+    steady_timer<std::function<void()>>* self = nullptr;
+
+    steady_timer<std::function<void()>> t([&]()
+    {
+        if(++calls == 1)
+        {
+            self->stop();
+            self->start();
+        }
+    }, 5ms, {}, false, false);
+
+    self = &t;
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return calls >= 3; }));
+    STE_CHECK(t.running());
+    t.stop();
+}
+
+void returning_false_on_an_executor_stops_the_timer()
+{
+    ste::thread_pool pool(1);
+    std::atomic<int> calls = 0;
+
+    steady_timer<std::function<bool()>> t([&]() { return ++calls < 3; }, 2ms, {}, false, false);
+    t.set_executor(pool);
+    t.start();
+
+    STE_CHECK(ste::test::eventually([&]() { return t.stopped(); }));
+    t.set_executor({}); // Waits for the calls in progress.
+
+    // A tick may have been handed off while the third call was returning.
+    const int after_stop = calls;
+    STE_CHECK(after_stop >= 3 && after_stop <= 4);
+
+    std::this_thread::sleep_for(20ms);
+    STE_CHECK(calls == after_stop);
+}
+
+void destroying_a_timer_while_its_pool_is_busy()
+{
+    ste::thread_pool pool(1);
+    std::atomic<int> calls = 0;
+
+    // Keeps the only pool thread busy: the calls of the timer queue up behind it.
+    pool.execute([]() { std::this_thread::sleep_for(30ms); });
+
+    {
+        steady_timer<std::function<void()>> t([&]() { ++calls; }, 1ms, {}, false, false);
+        t.set_executor(pool);
+        t.set_max_concurrency(0);
+        t.start();
+
+        std::this_thread::sleep_for(10ms);
+    } // Waits for the queued calls.
+
+    const int after_destruction = calls;
+    STE_CHECK(after_destruction >= 1);
+
+    std::this_thread::sleep_for(20ms);
+    STE_CHECK(calls == after_destruction);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("periodic calls follow delay and interval", periodic_calls_follow_delay_and_interval);
+    ste::test::run("single shot stops after one call", single_shot_stops_after_one_call);
+    ste::test::run("set_interval moves the pending call", set_interval_moves_the_pending_call);
+    ste::test::run("set_function from the function does not deadlock", set_function_from_the_function_does_not_deadlock);
+    ste::test::run("returned durations set the next interval", returned_durations_set_the_next_interval);
+    ste::test::run("returning false stops the timer", returning_false_stops_the_timer);
+    ste::test::run("zero intervals do not stall simulated time", zero_intervals_do_not_stall_simulated_time);
+    ste::test::run("phase offsets the first call within the interval", phase_offsets_the_first_call_within_the_interval);
+    ste::test::run("tick jitter stays within bounds", tick_jitter_stays_within_bounds);
+    ste::test::run("overrun policies count missed ticks", overrun_policies_count_missed_ticks);
+    ste::test::run("spinning timers fire on or after their deadlines", spinning_timers_fire_on_or_after_their_deadlines);
+    ste::test::run("stop interrupts a spin", stop_interrupts_a_spin);
+    ste::test::run("start / stop churn never overlaps calls", start_stop_churn_never_overlaps_calls);
+    ste::test::run("stop and destruction do not wait for the interval", stop_and_destruction_do_not_wait_for_the_interval);
+#if defined(__linux__)
+    ste::test::run("slack becomes the thread timer slack", slack_becomes_the_thread_timer_slack);
+#endif
+    ste::test::run("service timer restarts from its function", service_timer_restarts_from_its_function);
+    ste::test::run("thread timer restarts from its function", thread_timer_restarts_from_its_function);
+    ste::test::run("returning false on an executor stops the timer", returning_false_on_an_executor_stops_the_timer);
+    ste::test::run("destroying a timer while its pool is busy", destroying_a_timer_while_its_pool_is_busy);
+
+    return ste::test::result();
+}
@@ -0,0 +1,316 @@
+/*
+                        ste::timer tests: timer_service
+
+                 Ordering, cancellation, periodic expirations, timeouts,
+                 rescheduling and slack coalescing, on ste::manual_clock,
+                     and cancellation across dispatcher threads.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "manual_clock.hpp"
+
+#include "timer_service.hpp"
+
+#include <atomic>
+
+#include <chrono>
+
+#include <stdexcept>
+
+#include <string>
+
+#include <thread>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+using clock_type = ste::manual_clock;
+
+namespace
+{
+
+auto& service()
+{
+    return clock_type::service();
+}
+
+void equal_deadlines_run_in_scheduling_order()
+{
+    std::string order;
+    const auto deadline = clock_type::now() + 10ms;
+
+    service().schedule_at(deadline, [&]() { order += 'a'; });
+    service().schedule_at(deadline, [&]() { order += 'b'; });
+    service().schedule_at(deadline, [&]() { order += 'c'; });
+
+    clock_type::advance(10ms);
+
+    STE_CHECK(order == "abc");
+}
+
+void cancel_prevents_the_call()
+{
+    int calls = 0;
+    const auto id = service().schedule_after(5ms, [&]() { ++calls; });
+
+    STE_CHECK(service().pending(id));
+    STE_CHECK(service().cancel(id));
+    STE_CHECK(!service().cancel(id));
+    STE_CHECK(!service().pending(id));
+
+    clock_type::advance(10ms);
+
+    STE_CHECK(calls == 0);
+    STE_CHECK(service().size() == 0);
+}
+
+void periodic_expirations_fire_every_period()
+{
+    std::vector<clock_type::time_point> calls;
+    const auto start = clock_type::now();
+    const auto id    = service().schedule_every(10ms, 10ms, [&]() { calls.push_back(clock_type::now()); });
+
+    clock_type::advance(100ms);
+
+    STE_CHECK(calls.size() == 10);
+    STE_CHECK(!calls.empty() && calls.front() == start + 10ms && calls.back() == start + 100ms);
+    STE_CHECK(service().cancel(id));
+
+    clock_type::advance(100ms);
+
+    STE_CHECK(calls.size() == 10);
+}
+
+void cancelled_timeouts_do_not_fire()
+{
+    int cancelled = 0;
+    int fired     = 0;
+
+    const auto a = service().schedule_timeout(5ms, [&]() { ++cancelled; });
+    const auto b = service().schedule_timeout(5ms, [&]() { ++fired; });
+
+    STE_CHECK(service().pending(a));
+    STE_CHECK(service().cancel(a));
+    STE_CHECK(!service().cancel(a));
+
+    clock_type::advance(10ms);
+
+    STE_CHECK(cancelled == 0);
+    STE_CHECK(fired == 1);
+    STE_CHECK(!service().pending(b));
+    STE_CHECK(!service().cancel(b));
+}
+
+void timeout_slots_are_reused()
+{
+    int fired = 0;
+
+    for(int round = 0; round < 3; ++round)
+    {
+        std::vector<ste::basic_timer_service<clock_type>::timeout_handle> handles;
+
+        for(int i = 0; i < 100; ++i)
+        {
+            handles.push_back(service().schedule_timeout(5ms, [&]() { ++fired; }));
+        }
+
+        STE_CHECK(service().size() == 100);
+
+        for(std::size_t i = 0; i < handles.size(); i += 2)
+        {
+            STE_CHECK(service().cancel(handles[i]));
+        }
+
+        STE_CHECK(service().size() == 50);
+
+        clock_type::advance(10ms);
+
+        STE_CHECK(service().size() == 0);
+    }
+
+    STE_CHECK(fired == 150);
+}
+
+void reschedule_moves_the_deadline()
+{
+    clock_type::time_point called;
+    const auto start = clock_type::now();
+    const auto id    = service().schedule_at(start + 50ms, [&]() { called = clock_type::now(); });
+
+    STE_CHECK(service().reschedule(id, start + 5ms));
+
+    clock_type::advance(10ms);
+
+    STE_CHECK(called == start + 5ms);
+}
+
+void slack_does_not_delay_a_lone_expiration()
+{
+    const auto start = clock_type::now();
+    clock_type::time_point called;
+
+    service().schedule_at(start + 10ms, [&]() { called = clock_type::now(); }, 5ms);
+    clock_type::advance(20ms);
+
+    STE_CHECK(called == start + 10ms);
+}
+
+void overlapping_slack_windows_share_a_wakeup()
+{
+    const auto start     = clock_type::now();
+    const auto coalesced = service().coalesced_wakeups();
+
+    clock_type::time_point a;
+    clock_type::time_point b;
+
+    // a may run in [10, 15], b must run at 12: both run at 12.
+    service().schedule_at(start + 10ms, [&]() { a = clock_type::now(); }, 5ms);
+    service().schedule_at(start + 12ms, [&]() { b = clock_type::now(); });
+
+    clock_type::advance(20ms);
+
+    STE_CHECK(a == start + 12ms);
+    STE_CHECK(b == start + 12ms);
+    STE_CHECK(service().coalesced_wakeups() == coalesced + 1);
+}
+
+void callbacks_may_cancel_themselves()
+{
+    int calls = 0;
+    ste::basic_timer_service<clock_type>::id id = 0;
+
+    id = service().schedule_every(1ms, 1ms, [&]() { ++calls; service().cancel(id); });
+
+    clock_type::advance(10ms);
+
+    STE_CHECK(calls == 1);
+    STE_CHECK(service().size() == 0);
+}
+
+void cancel_from_another_dispatcher_waits()
+{
+    ste::timer_service threaded(2);
+    std::atomic<bool> returned = false;
+    std::atomic<bool> waited   = false;
+    std::atomic<ste::timer_service::id> slow = 0;
+
+    // Scheduled from the slow callback, so that the other dispatcher runs it.
+    slow = threaded.schedule_after(0ms, [&]()
+    {
+        while(slow == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        threaded.schedule_after(0ms, [&]()
+        {
+            threaded.cancel(slow);
+            waited = returned.load();
+        });
+
+        std::this_thread::sleep_for(50ms);
+        returned = true;
+    });
+
+    STE_CHECK(ste::test::eventually([&]() { return threaded.size() == 0; }));
+    STE_CHECK(waited);
+}
+
+void callbacks_cancelling_each_other_do_not_deadlock()
+{
+    ste::timer_service threaded(2);
+    std::atomic<bool> b_started = false;
+    std::atomic<int> done       = 0;
+    std::atomic<ste::timer_service::id> a = 0;
+
+    a = threaded.schedule_after(0ms, [&]()
+    {
+        while(a == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        const auto b = threaded.schedule_after(0ms, [&]()
+        {
+            b_started = true;
+            threaded.cancel(a);
+            ++done;
+        });
+
+        while(!b_started)
+        {
+            std::this_thread::yield();
+        }
+
+        threaded.cancel(b);
+        ++done;
+    });
+
+    STE_CHECK(ste::test::eventually([&]() { return done == 2; }));
+}
+
+void simulated_clocks_reject_dispatcher_threads()
+{
+    bool thrown = false;
+
+    try
+    {
+        ste::basic_timer_service<clock_type> threaded(1);
+    }
+    catch(const std::invalid_argument&)
+    {
+        thrown = true;
+    }
+
+    STE_CHECK(thrown);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("equal deadlines run in scheduling order", equal_deadlines_run_in_scheduling_order);
+    ste::test::run("cancel prevents the call", cancel_prevents_the_call);
+    ste::test::run("periodic expirations fire every period", periodic_expirations_fire_every_period);
+    ste::test::run("cancelled timeouts do not fire", cancelled_timeouts_do_not_fire);
+    ste::test::run("timeout slots are reused", timeout_slots_are_reused);
+    ste::test::run("reschedule moves the deadline", reschedule_moves_the_deadline);
+    ste::test::run("slack does not delay a lone expiration", slack_does_not_delay_a_lone_expiration);
+    ste::test::run("overlapping slack windows share a wakeup", overlapping_slack_windows_share_a_wakeup);
+    ste::test::run("callbacks may cancel themselves", callbacks_may_cancel_themselves);
+
+    ste::test::run("cancel from another dispatcher waits", cancel_from_another_dispatcher_waits);
+    ste::test::run("callbacks cancelling each other do not deadlock", callbacks_cancelling_each_other_do_not_deadlock);
+    ste::test::run("simulated clocks reject dispatcher threads", simulated_clocks_reject_dispatcher_threads);
+
+    return ste::test::result();
+}
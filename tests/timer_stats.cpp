@@ -0,0 +1,171 @@
+/*
+                        ste::timer tests: timer_stats
+
+                 Histogram bucket boundaries and percentiles, and the statistics of a
+                 timer on ste::manual_clock. Built with STE_TIMER_STATS.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#if !defined(STE_TIMER_STATS)
+#define STE_TIMER_STATS
+#endif
+
+#include "check.hpp"
+
+#include "manual_clock.hpp"
+
+#include "timer.hpp"
+
+#include "timer_stats.hpp"
+
+#include <chrono>
+
+#include <cstdint>
+
+#include <functional>
+
+#include <limits>
+
+using namespace std::chrono_literals;
+
+using snapshot = ste::histogram_snapshot;
+
+namespace
+{
+
+void small_values_have_their_own_bucket()
+{
+    for(std::uint64_t v = 0; v < snapshot::sub_buckets; ++v)
+    {
+        STE_CHECK(snapshot::bucket_of(v) == v);
+        STE_CHECK(snapshot::upper_bound_of(v) == v);
+    }
+
+    STE_CHECK(snapshot::bucket_of(snapshot::sub_buckets) == snapshot::sub_buckets);
+}
+
+void buckets_are_contiguous()
+{
+    // The value after the upper bound of a bucket is in the next one.
+    for(std::size_t i = 0; i + 1 < snapshot::buckets; ++i)
+    {
+        const auto upper = snapshot::upper_bound_of(i);
+
+        STE_CHECK(snapshot::bucket_of(upper) == i);
+        STE_CHECK(snapshot::bucket_of(upper + 1) == i + 1);
+    }
+
+    STE_CHECK(snapshot::bucket_of(std::numeric_limits<std::uint64_t>::max()) == snapshot::buckets - 1);
+    STE_CHECK(snapshot::upper_bound_of(snapshot::buckets - 1) == std::numeric_limits<std::uint64_t>::max());
+}
+
+void relative_error_is_below_one_eighth()
+{
+    for(std::size_t i = snapshot::sub_buckets + 1; i < snapshot::buckets; ++i)
+    {
+        const auto lower = snapshot::upper_bound_of(i - 1) + 1;
+        const auto upper = snapshot::upper_bound_of(i);
+
+        STE_CHECK((upper - lower) < lower / 8 + 1);
+    }
+}
+
+void percentiles_are_bucket_upper_bounds()
+{
+    ste::histogram h;
+
+    STE_CHECK(h.snapshot().percentile(50) == 0);
+
+    for(std::uint64_t v = 1; v <= 100; ++v)
+    {
+        h.record(v);
+    }
+
+    const auto s = h.snapshot();
+
+    STE_CHECK(s.count == 100);
+    STE_CHECK(s.sum == 5050);
+    STE_CHECK(s.mean() == 50);
+    STE_CHECK(s.max == 100);
+
+    STE_CHECK(s.percentile(0) == 1);
+    STE_CHECK(s.percentile(50) == snapshot::upper_bound_of(snapshot::bucket_of(50)));
+    STE_CHECK(s.percentile(50) >= 50 && s.percentile(50) <= 56);
+    STE_CHECK(s.percentile(99) >= 99 && s.percentile(99) <= 100);
+    STE_CHECK(s.percentile(100) == 100); // Capped by the maximum, not the bucket bound (103).
+
+    h.reset();
+    STE_CHECK(h.snapshot().count == 0);
+    STE_CHECK(h.snapshot().percentile(99) == 0);
+}
+
+void negative_durations_are_recorded_as_zero()
+{
+    ste::histogram h;
+    h.record(-5ns);
+
+    const auto s = h.snapshot();
+
+    STE_CHECK(s.count == 1);
+    STE_CHECK(s.counts[0] == 1);
+    STE_CHECK(s.max == 0);
+}
+
+void timers_record_their_calls()
+{
+    ste::timer<std::function<void()>, std::chrono::milliseconds, std::chrono::milliseconds, ste::manual_clock>
+        t([]() {}, 10ms, {}, false, true);
+
+    ste::manual_clock::advance(50ms);
+    t.stop();
+
+    const auto s = t.stats();
+
+    STE_CHECK(s.fires == 5);
+    STE_CHECK(s.lateness.count == 5);
+    STE_CHECK(s.lateness.max == 0); // Simulated time: every call is on time.
+    STE_CHECK(s.duration.count == 5);
+
+    t.reset_stats();
+    STE_CHECK(t.stats().fires == 0);
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("small values have their own bucket", small_values_have_their_own_bucket);
+    ste::test::run("buckets are contiguous", buckets_are_contiguous);
+    ste::test::run("relative error is below one eighth", relative_error_is_below_one_eighth);
+    ste::test::run("percentiles are bucket upper bounds", percentiles_are_bucket_upper_bounds);
+    ste::test::run("negative durations are recorded as zero", negative_durations_are_recorded_as_zero);
+    ste::test::run("timers record their calls", timers_record_their_calls);
+
+    return ste::test::result();
+}
@@ -0,0 +1,163 @@
+/*
+                        ste::timer tests: timerfd_timer
+
+                 Start / stop, single shot and expiration counting, dispatched by hand.
+                 Linux only.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "check.hpp"
+
+#include "timerfd_timer.hpp"
+
+#include <poll.h>
+
+#include <chrono>
+
+#include <functional>
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+template<typename function_t>
+using ms_timerfd_timer = ste::timerfd_timer<function_t, std::chrono::milliseconds, std::chrono::milliseconds>;
+
+namespace
+{
+
+/// Returns 'true' if 'fd' becomes readable within 'timeout'.
+bool readable(const int fd, const std::chrono::milliseconds timeout)
+{
+    pollfd p = {};
+    p.fd     = fd;
+    p.events = POLLIN;
+
+    return ::poll(&p, 1, static_cast<int>(timeout.count())) == 1;
+}
+
+void single_shot_fires_once_then_stops()
+{
+    int calls = 0;
+    ms_timerfd_timer<std::function<void()>> t([&]() { ++calls; }, 5ms);
+
+    STE_CHECK(!readable(t.fd(), 20ms)); // Not started.
+
+    t.start();
+    STE_CHECK(t.running());
+    STE_CHECK(readable(t.fd(), 1s));
+    STE_CHECK(t.dispatch_ready() == 1);
+    STE_CHECK(calls == 1);
+    STE_CHECK(t.stopped());
+
+    STE_CHECK(!readable(t.fd(), 20ms));
+    STE_CHECK(t.dispatch_ready() == 0);
+    STE_CHECK(calls == 1);
+}
+
+void stop_drops_pending_expirations()
+{
+    int calls = 0;
+    ms_timerfd_timer<std::function<void()>> t([&]() { ++calls; }, 5ms, {}, false);
+
+    t.start();
+    std::this_thread::sleep_for(20ms);
+    t.stop();
+
+    STE_CHECK(!readable(t.fd(), 0ms));
+    STE_CHECK(t.dispatch_ready() == 0);
+    STE_CHECK(calls == 0);
+
+    // Restarts from now.
+    t.start();
+    STE_CHECK(readable(t.fd(), 1s));
+    STE_CHECK(t.dispatch_ready() == 1);
+    STE_CHECK(calls == 1);
+    t.stop();
+}
+
+/// Lets a 5ms periodic timer expire for 32ms before dispatching. Returns the calls made.
+std::size_t dispatch_after_overrun(ms_timerfd_timer<std::function<void()>>& t)
+{
+    t.start();
+    std::this_thread::sleep_for(32ms);
+
+    const auto calls = t.dispatch_ready();
+    t.stop();
+
+    return calls;
+}
+
+void periodic_expirations_are_counted()
+{
+    int calls = 0;
+    ms_timerfd_timer<std::function<void()>> t([&]() { ++calls; }, 5ms, {}, false);
+
+    // The kernel counted every expiration: all of them are called back to back.
+    t.set_period_mode(ste::period_mode::catch_up);
+    const auto caught_up = dispatch_after_overrun(t);
+
+    STE_CHECK(caught_up >= 6);
+    STE_CHECK(calls == static_cast<int>(caught_up));
+    STE_CHECK(t.missed_ticks() == caught_up - 1);
+
+    // Only one call, the others are missed.
+    t.set_period_mode(ste::period_mode::skip);
+    const auto missed_before = t.missed_ticks();
+
+    STE_CHECK(dispatch_after_overrun(t) == 1);
+    STE_CHECK(t.missed_ticks() - missed_before >= 5);
+}
+
+void periodic_timers_keep_firing()
+{
+    int calls = 0;
+    ms_timerfd_timer<std::function<void()>> t([&]() { ++calls; }, 2ms, {}, false, true);
+
+    for(int i = 0; i < 5; ++i)
+    {
+        STE_CHECK(readable(t.fd(), 1s));
+        t.dispatch_ready();
+    }
+
+    STE_CHECK(calls >= 5);
+    STE_CHECK(t.running());
+}
+
+} //namespace
+
+int main()
+{
+    ste::test::run("single shot fires once then stops", single_shot_fires_once_then_stops);
+    ste::test::run("stop drops pending expirations", stop_drops_pending_expirations);
+    ste::test::run("periodic expirations are counted", periodic_expirations_are_counted);
+    ste::test::run("periodic timers keep firing", periodic_timers_keep_firing);
+
+    return ste::test::result();
+}
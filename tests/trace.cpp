@@ -0,0 +1,189 @@
+/*
+                        ste::timer tests: trace
+
+                 One stop event per stop, whoever stops the timer.
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Compiled with tracing whatever the build options.
+#if !defined(STE_TIMER_TRACE)
+#define STE_TIMER_TRACE
+#endif
+
+#include "check.hpp"
+
+#include "manual_clock.hpp"
+
+#include "timer.hpp"
+
+#include "trace.hpp"
+
+#include <chrono>
+
+#include <cstdint>
+
+#include <cstdlib>
+
+#include <filesystem>
+
+#include <fstream>
+
+#include <functional>
+
+#include <string>
+
+#include <thread>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+template<typename function_t>
+using manual_timer = ste::timer<function_t, std::chrono::milliseconds, std::chrono::milliseconds, ste::manual_clock>;
+
+template<typename function_t>
+using steady_timer = ste::timer<function_t, std::chrono::milliseconds, std::chrono::milliseconds>;
+
+namespace
+{
+
+/// Directory of the trace files of this test.
+std::string directory;
+
+/// Returns the types of the events recorded for 'timer' by every thread, oldest first within a thread.
+std::vector<ste::trace::event_type> events_of(const void* const timer)
+{
+    std::vector<ste::trace::event_type> types;
+
+    for(const auto& file : std::filesystem::directory_iterator(directory))
+    {
+        std::ifstream in(file.path(), std::ios::binary);
+
+        ste::trace::file_header header;
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        std::vector<ste::trace::event> ring(header.capacity);
+        in.read(reinterpret_cast<char*>(ring.data()), static_cast<std::streamsize>(ring.size() * sizeof(ste::trace::event)));
+
+        for(std::uint64_t i = 0; i < header.head.load(); ++i)
+        {
+            if(ring[i].timer == reinterpret_cast<std::uintptr_t>(timer))
+            {
+                types.push_back(ring[i].type);
+            }
+        }
+    }
+
+    return types;
+}
+
+/// Returns the number of stop events recorded for 'timer'.
+std::size_t stops_of(const void* const timer)
+{
+    std::size_t stops = 0;
+
+    for(const auto type : events_of(timer))
+    {
+        stops += type == ste::trace::event_type::stop ? 1 : 0;
+    }
+
+    return stops;
+}
+
+void single_shot_records_its_stop()
+{
+    manual_timer<std::function<void()>> t([]() {}, 10ms, {}, true, true);
+
+    ste::manual_clock::advance(100ms);
+    STE_CHECK(t.stopped());
+
+    using type = ste::trace::event_type;
+    STE_CHECK((events_of(&t) == std::vector<type>{type::start, type::fire, type::stop}));
+
+    t.stop();
+    STE_CHECK(stops_of(&t) == 1);
+}
+
+void function_returning_false_records_its_stop()
+{
+    steady_timer<std::function<bool()>> t([]() { return false; }, 1ms, {}, false, true);
+
+    STE_CHECK(ste::test::eventually([&]() { return t.stopped(); }));
+    STE_CHECK(stops_of(&t) == 1);
+
+    t.stop();
+    STE_CHECK(stops_of(&t) == 1);
+}
+
+void concurrent_stops_record_one_stop()
+{
+    for(int i = 0; i < 20; ++i)
+    {
+        steady_timer<std::function<void()>> t([]() {}, 1ms, {}, false, false);
+
+        // Each iteration's timer may live at the address of the previous one.
+        const std::size_t before = stops_of(&t);
+        t.start();
+
+        std::thread other([&]() { t.stop(); });
+        t.stop();
+        other.join();
+
+        STE_CHECK(stops_of(&t) == before + 1);
+
+        t.start();
+        t.stop();
+        STE_CHECK(stops_of(&t) == before + 2);
+    }
+}
+
+} //namespace
+
+int main()
+{
+    char path[] = "/tmp/ste-trace-test.XXXXXX";
+
+    if(::mkdtemp(path) == nullptr)
+    {
+        return 1;
+    }
+
+    directory = path;
+    ste::trace::set_directory(directory);
+    ste::trace::set_capacity(4096);
+
+    ste::test::run("single shot records its stop", single_shot_records_its_stop);
+    ste::test::run("function returning false records its stop", function_returning_false_records_its_stop);
+    ste::test::run("concurrent stops record one stop", concurrent_stops_record_one_stop);
+
+    const int result = ste::test::result();
+    std::filesystem::remove_all(directory);
+
+    return result;
+}
@@ -0,0 +1,202 @@
+/*
+                        ste::timer trace converter
+
+                 Converts the trace files written when STE_TIMER_TRACE
+                 is defined (see include/trace.hpp) to Chrome
+                 trace-event JSON, for Perfetto or chrome://tracing.
+
+                 Usage: ste-trace2json file.bin... > trace.json
+
+     Copyright (C) <2020-2022>  DUHAMEL Erwan (erwanduhamel@outlook.com)
+
+                        BSD-2 License
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        * Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation
+          and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER
+    OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+    PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+    PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+    LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+    NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../include/trace.hpp"
+
+#include <cinttypes>
+
+#include <cstdio>
+
+#include <cstring>
+
+#include <fstream>
+
+#include <iostream>
+
+#include <string>
+
+#include <vector>
+
+namespace
+{
+
+/// Reads the events of one trace file, oldest first. Returns 'false' if it is not a trace file.
+bool read_file(const char* path, ste::trace::file_header& header, std::vector<ste::trace::event>& events)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+
+    const std::streamoff size = in.tellg();
+    in.seekg(0);
+
+    if(size < static_cast<std::streamoff>(sizeof(header)))
+    {
+        return false;
+    }
+
+    // Events the file can hold: a corrupted capacity must not size the ring.
+    const std::uint64_t room = static_cast<std::uint64_t>(size - static_cast<std::streamoff>(sizeof(header))) / sizeof(ste::trace::event);
+
+    // 'head' is a lock-free atomic: its bytes are the plain counter.
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, ste::trace::magic, sizeof(ste::trace::magic)) != 0 ||
+       header.version != ste::trace::version ||
+       header.event_size != sizeof(ste::trace::event) ||
+       header.capacity == 0 ||
+       header.capacity > room)
+    {
+        return false;
+    }
+
+    std::vector<ste::trace::event> ring(header.capacity);
+
+    if(!in.read(reinterpret_cast<char*>(ring.data()), static_cast<std::streamsize>(ring.size() * sizeof(ste::trace::event))))
+    {
+        return false;
+    }
+
+    const std::uint64_t head  = header.head.load();
+    const std::uint64_t count = head < header.capacity ? head : header.capacity;
+
+    events.clear();
+    events.reserve(count);
+
+    for(std::uint64_t i = head - count; i < head; ++i)
+    {
+        events.push_back(ring[i % header.capacity]);
+    }
+
+    return true;
+}
+
+/// Prints 'ns' nanoseconds in microseconds, the unit of the trace-event format.
+void print_us(const std::uint64_t ns)
+{
+    std::printf("%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+}
+
+/// Prints 'e'. Returns 'false', printing nothing, if its type is unknown.
+bool print_event(const ste::trace::event& e, const std::uint32_t process, bool& first)
+{
+    switch(e.type)
+    {
+        case ste::trace::event_type::start:
+        case ste::trace::event_type::stop:
+        case ste::trace::event_type::fire:
+        case ste::trace::event_type::overrun:
+            break;
+
+        default:
+            return false;
+    }
+
+    std::printf("%s\n    {\"pid\": %" PRIu32 ", \"tid\": %" PRIu32 ", \"ts\": ", first ? "" : ",", process, e.thread);
+    print_us(e.timestamp);
+
+    first = false;
+
+    switch(e.type)
+    {
+        case ste::trace::event_type::fire:
+            std::printf(", \"ph\": \"X\", \"dur\": ");
+            print_us(e.value);
+            std::printf(", \"cat\": \"ste\", \"name\": \"timer 0x%" PRIx64 "\", \"args\": {\"lateness_ns\": %" PRId64 "}}", e.timer, e.lateness);
+            break;
+
+        case ste::trace::event_type::overrun:
+            std::printf(", \"ph\": \"i\", \"s\": \"t\", \"cat\": \"ste\", \"name\": \"overrun\", \"args\": {\"timer\": \"0x%" PRIx64 "\", \"deadlines\": %" PRIu64 "}}", e.timer, e.value);
+            break;
+
+        case ste::trace::event_type::start:
+            std::printf(", \"ph\": \"i\", \"s\": \"t\", \"cat\": \"ste\", \"name\": \"start\", \"args\": {\"timer\": \"0x%" PRIx64 "\"}}", e.timer);
+            break;
+
+        case ste::trace::event_type::stop:
+            std::printf(", \"ph\": \"i\", \"s\": \"t\", \"cat\": \"ste\", \"name\": \"stop\", \"args\": {\"timer\": \"0x%" PRIx64 "\"}}", e.timer);
+            break;
+    }
+
+    return true;
+}
+
+} //namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: ste-trace2json file.bin... > trace.json" << std::endl;
+        return 1;
+    }
+
+    std::printf("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+
+    bool first = true;
+    int status = 0;
+
+    ste::trace::file_header header = {};
+    std::vector<ste::trace::event> events;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!read_file(argv[i], header, events))
+        {
+            std::cerr << argv[i] << ": not a ste::timer trace file" << std::endl;
+            status = 1;
+            continue;
+        }
+
+        std::printf("%s\n    {\"pid\": %" PRIu32 ", \"tid\": %" PRIu32 ", \"ph\": \"M\", \"name\": \"thread_name\", \"args\": {\"name\": \"thread %" PRIu32 "\"}}",
+                    first ? "" : ",", header.process, header.thread, header.thread);
+        first = false;
+
+        std::uint64_t unknown = 0;
+
+        for(const auto& e : events)
+        {
+            unknown += print_event(e, header.process, first) ? 0 : 1;
+        }
+
+        if(unknown != 0)
+        {
+            std::cerr << argv[i] << ": " << unknown << " event(s) of unknown type skipped" << std::endl;
+        }
+    }
+
+    std::printf("\n]}\n");
+
+    return status;
+}